@@ -0,0 +1,128 @@
+#include "doctest/doctest.h"
+#include "really/any_array.hpp"
+
+#include <array>
+#include <string>
+#include <vector>
+
+using namespace really;
+
+namespace
+{
+using block = std::array<int, 8>;
+
+std::vector<block> blocks_of(int count)
+{
+	std::vector<block> blocks(count);
+	for (int i = 0; i < count; ++i)
+	{
+		blocks[i].fill(i);
+	}
+	return blocks;
+}
+
+// Too big for the inline buffer; copying the third one throws.
+struct throwing_block
+{
+	static inline int copies = 0;
+
+	throwing_block() = default;
+	throwing_block(const throwing_block& other) : data(other.data)
+	{
+		if (++copies == 3)
+		{
+			throw 3;
+		}
+	}
+	throwing_block& operator=(const throwing_block&) = default;
+
+	block data{};
+};
+
+std::ptrdiff_t distance(const any<>& a, const any<>& b)
+{
+	return static_cast<const char*>(b.data()) - static_cast<const char*>(a.data());
+}
+} // namespace
+
+TEST_SUITE_BEGIN("any_array");
+
+TEST_CASE("any-array-slab-payloads")
+{
+	std::vector<any<>> values = make_any_array(blocks_of(16));
+	REQUIRE(values.size() == 16);
+	// Payloads are laid out back to back in one block.
+	for (size_t i = 0; i + 1 < values.size(); ++i)
+	{
+		CHECK(distance(values[i], values[i + 1]) ==
+			  static_cast<std::ptrdiff_t>(detail::payload_slab::footprint(sizeof(block))));
+		CHECK(values[i].value<block>()[3] == static_cast<int>(i));
+	}
+
+	// Elements reset, reassign, copy and move independently of the slab.
+	values[0].reset();
+	values[1] = 5;
+	any<> copy = values[2];
+	any<> moved = std::move(values[3]);
+	CHECK(copy.value<block>()[0] == 2);
+	CHECK(moved.value<block>()[0] == 3);
+	values.erase(values.begin(), values.begin() + 8);
+	CHECK(values[0].value<block>()[0] == 8);
+	values.clear();
+	CHECK(moved.value<block>()[7] == 3);
+}
+
+TEST_CASE("any-array-from-anys-and-emplace-n")
+{
+	std::vector<any<>> mixed;
+	mixed.emplace_back(1);
+	mixed.emplace_back(std::string(40, 'x'));
+	mixed.emplace_back();
+	mixed.emplace_back(block{});
+	mixed.emplace_back(2.5);
+
+	std::vector<any<>> values = make_any_array(mixed);
+	REQUIRE(values.size() == 5);
+	CHECK(values[0].value<int>() == 1);
+	CHECK(values[1].value<std::string>() == std::string(40, 'x'));
+	CHECK(!values[2].has_value());
+	CHECK(values[3].has_type<block>());
+	CHECK(values[4].value<double>() == 2.5);
+	CHECK(distance(values[1], values[3]) ==
+		  static_cast<std::ptrdiff_t>(detail::payload_slab::footprint(sizeof(std::string))));
+
+	// Small values need no slab at all.
+	std::vector<any<>> ints = make_any_array(std::vector<int>{1, 2, 3});
+	CHECK(ints[2].value<int>() == 3);
+
+	// Storages that can't carve payloads allocate each one as usual.
+	std::vector<heap_any<>> heap_values = make_any_array<heap_any<>>(blocks_of(3));
+	CHECK(heap_values[2].value<block>()[0] == 2);
+	emplace_n<int>(heap_values, 2, 9);
+	CHECK(heap_values[4].value<int>() == 9);
+	std::vector<heap_any<>> heap_copies = make_any_array<heap_any<>>(mixed);
+	CHECK(heap_copies[1].value<std::string>() == std::string(40, 'x'));
+
+	emplace_n<std::string>(values, 3, size_t(20), 'y');
+	REQUIRE(values.size() == 8);
+	CHECK(values[7].value<std::string>() == std::string(20, 'y'));
+	CHECK(distance(values[5], values[6]) ==
+		  static_cast<std::ptrdiff_t>(detail::payload_slab::footprint(sizeof(std::string))));
+}
+
+TEST_CASE("any-array-releases-slab-on-exception")
+{
+	// Payloads built before the throw are destroyed with the vector; the slab goes with the
+	// last of them instead of leaking.
+	std::vector<throwing_block> sources(5);
+	bool threw = false;
+	try
+	{
+		make_any_array(sources);
+	}
+	catch (int)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+}
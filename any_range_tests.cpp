@@ -0,0 +1,73 @@
+#include "doctest/doctest.h"
+#include "really/any_range.hpp"
+#include "really/archetype_store.hpp"
+#include "really/slot_map.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace really;
+
+TEST_SUITE_BEGIN("any_range");
+
+TEST_CASE("any-range-typed-and-erased-pull")
+{
+	std::vector<std::string> words = {"a", "b", "c", "d", "e"};
+
+	// Typed pulls fill the caller's buffer a batch at a time.
+	any_range range = make_any_range(words);
+	CHECK(range.has_element_type<std::string>());
+	std::string batch[2];
+	CHECK(range.pull(std::span<std::string>(batch)) == 2);
+	CHECK(batch[1] == "b");
+	CHECK(range.pull(std::span<std::string>(batch)) == 2);
+	CHECK(batch[0] == "c");
+	CHECK(range.pull(std::span<std::string>(batch)) == 1);
+	CHECK(range.pull(std::span<std::string>(batch)) == 0);
+
+	// Consumers that don't know the type get anys, including through range-for.
+	std::string joined;
+	for (any<>& value : make_any_range(std::vector<std::string>(words)))
+	{
+		joined += value.value<std::string>();
+	}
+	CHECK(joined == "abcde");
+
+	// A range of anys yields the held values, and for_each skips other types.
+	slot_map<> map;
+	for (int i = 0; i < 100; ++i)
+	{
+		map.emplace<int>(i);
+		map.emplace<std::string>("x");
+	}
+	int sum = 0;
+	make_any_range(map.values()).for_each<int>([&](int& value) { sum += value; });
+	CHECK(sum == 4950);
+}
+
+TEST_CASE("any-range-runtime-typed-column")
+{
+	archetype_store store;
+	for (int i = 0; i < 200; ++i)
+	{
+		store.add<std::string>(store.create(), std::to_string(i % 10));
+	}
+
+	const type_info types[] = {get_type_info<std::string>()};
+	size_t length = 0;
+	size_t erased = 0;
+	store.for_each_archetype(types, [&](archetype& arch) {
+		const any_type_operations* ops = arch.operations(types[0]);
+		REQUIRE(ops != nullptr);
+		make_any_range(*ops, arch.column(types[0]), arch.size())
+			.for_each<std::string>([&](std::string& value) { length += value.size(); });
+
+		any_range range = make_any_range(*ops, arch.column(types[0]), arch.size());
+		for (any<>& value : range)
+		{
+			erased += value.has_type<std::string>();
+		}
+	});
+	CHECK(length == 200);
+	CHECK(erased == 200);
+}
@@ -1,6 +1,8 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest/doctest.h"
 #include "really/any.hpp"
+#include <array>
+#include <cstdint>
 #include <iostream>
 
 using namespace really;
@@ -60,6 +62,55 @@ struct operation_counter
 	}
 };
 
+struct base_a
+{
+	virtual ~base_a() = default;
+	int a = 1;
+};
+
+struct base_b
+{
+	int b = 2;
+};
+
+struct derived : base_a, base_b
+{
+	int c = 3;
+};
+
+struct more_derived : derived
+{
+	int d = 4;
+};
+
+struct trivial_point
+{
+	int x;
+	int y;
+};
+
+struct trivial_size
+{
+	float width = 1.5f;
+	float height = 2.5f;
+};
+
+// Only ever stored in an any, so nothing else registers its name in hash-only debug builds.
+struct only_stored_trivial
+{
+	int value;
+};
+
+template <>
+struct really::base_classes<derived> : really::bases<base_a, base_b>
+{
+};
+
+template <>
+struct really::base_classes<more_derived> : really::bases<derived>
+{
+};
+
 TEST_SUITE_BEGIN("any");
 
 TEST_CASE_TEMPLATE("basic-usage", any_t, copyable_any, movable_any)
@@ -69,15 +120,15 @@ TEST_CASE_TEMPLATE("basic-usage", any_t, copyable_any, movable_any)
 
 	a = 5;
 	CHECK(a.has_value());
-	CHECK(a.has_type<int>());
-	CHECK(a.try_get_value<int>() != nullptr);
-	CHECK(a.try_get_value<char>() == nullptr);
-	CHECK(a.value<int>() == 5);
+	CHECK(a.template has_type<int>());
+	CHECK(a.template try_get_value<int>() != nullptr);
+	CHECK(a.template try_get_value<char>() == nullptr);
+	CHECK(a.template value<int>() == 5);
 
 	a.reset();
 	CHECK(!a.has_value());
-	CHECK(!a.has_type<int>());
-	CHECK(a.try_get_value<int>() == nullptr);
+	CHECK(!a.template has_type<int>());
+	CHECK(a.template try_get_value<int>() == nullptr);
 }
 
 TEST_CASE("nonmovable-any")
@@ -105,7 +156,7 @@ TEST_CASE_TEMPLATE("any-type-handling", any_t, copyable_any, movable_any,
 	any_t a;
 
 	// default construction
-	a.emplace<operation_counter>();
+	a.template emplace<operation_counter>();
 	CHECK(operation_counter::instances == 1);
 	CHECK(operation_counter::default_constructed == 1);
 
@@ -138,9 +189,132 @@ TEST_CASE_TEMPLATE("any-type-handling", any_t, copyable_any, movable_any,
 	{
 		operation_counter::reset();
 		operation_counter oc;
-		a.emplace<operation_counter>(oc);
+		a.template emplace<operation_counter>(oc);
 		CHECK(operation_counter::copy_constructed == 1);
 	}
 }
 
+TEST_CASE("any-cast-to-base")
+{
+	any<> a = more_derived{};
+	more_derived& stored = a.value<more_derived>();
+
+	CHECK(any_cast<more_derived>(&a) == &stored);
+	CHECK(any_cast<derived>(&a) == static_cast<derived*>(&stored));
+	CHECK(any_cast<base_a>(&a) == static_cast<base_a*>(&stored));
+	CHECK(any_cast<base_b>(&a) == static_cast<base_b*>(&stored));
+	CHECK(any_cast<base_b>(&a)->b == 2);
+
+	const any<>& const_a = a;
+	CHECK(any_cast<base_b>(&const_a) == static_cast<const base_b*>(&stored));
+
+	CHECK(any_cast<int>(&a) == nullptr);
+	any<> empty;
+	CHECK(any_cast<base_a>(&empty) == nullptr);
+
+	// Unregistered hierarchies only match exactly.
+	any<> b = base_b{};
+	CHECK(any_cast<base_a>(&b) == nullptr);
+}
+
+TEST_CASE("realtime-allocation-guard")
+{
+	struct large
+	{
+		char data[64];
+	};
+
+	static size_t reported = 0;
+	realtime_allocation_handler previous =
+		set_realtime_allocation_handler([](size_t size) { reported += size; });
+
+	any<> outside = large{};
+	CHECK(reported == 0);
+	{
+		realtime_scope scope;
+		CHECK(in_realtime_scope());
+		any<> inline_value = 5;
+		CHECK(reported == 0);
+		any<> heap_value = large{};
+		CHECK(reported == sizeof(large));
+		heap_any<> copy = outside;
+		CHECK(copy.has_type<large>());
+		CHECK(reported == 2 * sizeof(large));
+	}
+	CHECK(!in_realtime_scope());
+	set_realtime_allocation_handler(previous);
+
+	// The real-time any rejects anything that could allocate at compile time, including
+	// conversions from anys that may hold larger values.
+	static_assert(std::is_constructible_v<realtime_any<>, double>);
+	static_assert(!std::is_constructible_v<realtime_any<>, large>);
+	static_assert(!std::is_assignable_v<realtime_any<>&, large>);
+	static_assert(!std::is_constructible_v<realtime_any<>, any<>>);
+	static_assert(!std::is_constructible_v<any_of_size<32>, const any<>&>);
+	static_assert(std::is_constructible_v<realtime_any<>, any_of_size<8>>);
+	static_assert(!std::is_constructible_v<any_of_size<8>, realtime_any<>>);
+
+	realtime_any<> small(any_of_size<8>(2.5));
+	CHECK(small.value<double>() == 2.5);
+
+	// Exactly the values any<> keeps inline fit, and inline values are suitably aligned.
+	constexpr size_t any_inline = 2 * sizeof(void*) - 1;
+	static_assert(std::is_constructible_v<realtime_any<>, std::array<char, any_inline>>);
+	static_assert(!std::is_constructible_v<realtime_any<>, std::array<char, any_inline + 1>>);
+	any_of_size<sizeof(long double)> wide(1.5L);
+	CHECK(reinterpret_cast<uintptr_t>(&wide.value<long double>()) % alignof(long double) == 0);
+}
+
+TEST_CASE("type-info-identity")
+{
+	constexpr type_info int_type = get_type_info<int>();
+	static_assert(int_type == get_type_info<int>());
+	static_assert(int_type != get_type_info<unsigned int>());
+	static_assert(int_type.hash_code() == static_cast<size_t>(type_name_hash(type_name<int>())));
+
+	any<> a = 1;
+	CHECK(a.type() == int_type);
+	CHECK(a.type().hash_code() == int_type.hash_code());
+	CHECK(int_type.before(get_type_info<unsigned int>()) !=
+		  get_type_info<unsigned int>().before(int_type));
+
+	// Hash-only release builds drop the names.
+#if !defined(REALLY_ANY_HASH_ONLY_TYPE_INFO) || !defined(NDEBUG)
+	CHECK(int_type.name() == "int");
+
+	// Types reaching an any through compile-time operations tables are named too.
+	any<> trivial = only_stored_trivial{1};
+	CHECK(trivial.type().name() == type_name<only_stored_trivial>());
+	any<> number = 2;
+	CHECK(!number.type().name().empty());
+#endif
+}
+
+TEST_CASE("any-shared-trivial-operations")
+{
+	// Same-size trivial types share one operations class but keep distinct identities.
+	static_assert(std::is_same_v<decltype(detail::type_operations<trivial_point>),
+								 decltype(detail::type_operations<trivial_size>)>);
+	static_assert(!std::is_same_v<decltype(detail::type_operations<trivial_point>),
+								  decltype(detail::type_operations<operation_counter>)>);
+	const any_type_operations& point_ops = get_type_operations<trivial_point>();
+	const any_type_operations& size_ops = get_type_operations<trivial_size>();
+	CHECK(&point_ops != &size_ops);
+	CHECK(point_ops.get_type_info() == get_type_info<trivial_point>());
+	CHECK(size_ops.get_type_info() == get_type_info<trivial_size>());
+
+	any<> a = trivial_point{3, 4};
+	any<> b = a;
+	CHECK(b.value<trivial_point>().y == 4);
+	CHECK(b.try_get_value<trivial_size>() == nullptr);
+
+	// Default construction still honours member initializers, and zero-fills otherwise.
+	trivial_size size{0, 0};
+	CHECK(size_ops.default_construct(&size));
+	CHECK(size.height == 2.5f);
+	trivial_point point{7, 7};
+	CHECK(point_ops.default_construct(&point));
+	CHECK(point.x == 0);
+}
+
 TEST_SUITE_END();
@@ -0,0 +1,219 @@
+#include "doctest/doctest.h"
+#include "really/archetype_store.hpp"
+
+#include <stdexcept>
+#include <string>
+
+using namespace really;
+
+namespace
+{
+struct position
+{
+	float x, y;
+};
+
+struct velocity
+{
+	float dx, dy;
+};
+
+struct checked_name
+{
+	explicit checked_name(std::string n) : name(std::move(n))
+	{
+		if (name.empty())
+		{
+			throw std::invalid_argument("empty name");
+		}
+	}
+
+	std::string name;
+};
+
+// Can be constructed and copied, but not assigned.
+struct fixed
+{
+	const int id;
+};
+
+// Throws from the copy constructor once copies_left reaches zero.
+struct fragile
+{
+	static inline int copies_left = 0;
+	static inline int live = 0;
+
+	fragile() { ++live; }
+	fragile(const fragile&)
+	{
+		if (copies_left-- == 0)
+		{
+			throw std::runtime_error("fragile copy");
+		}
+		++live;
+	}
+	fragile& operator=(const fragile&) = default;
+	~fragile() { --live; }
+};
+} // namespace
+
+TEST_SUITE_BEGIN("archetype_store");
+
+TEST_CASE("archetype-store-components")
+{
+	archetype_store store;
+	entity a = store.create();
+	CHECK(store.alive(a));
+
+	store.add<position>(a, 1.0f, 2.0f);
+	store.add<std::string>(a, "a");
+	CHECK(store.get<position>(a)->y == 2.0f);
+	CHECK(*store.get<std::string>(a) == "a");
+	CHECK(store.get<velocity>(a) == nullptr);
+
+	// Replacing keeps the entity in the same archetype.
+	store.add<std::string>(a, "b");
+	CHECK(*store.get<std::string>(a) == "b");
+
+	CHECK(store.remove<position>(a));
+	CHECK(!store.remove<position>(a));
+	CHECK(store.get<position>(a) == nullptr);
+	CHECK(*store.get<std::string>(a) == "b");
+
+	// Components whose type is only known at runtime arrive in an any.
+	any<> runtime_component = velocity{3.0f, 4.0f};
+	CHECK(store.add(a, std::move(runtime_component)) != nullptr);
+	CHECK(!runtime_component.has_value());
+	CHECK(store.get<velocity>(a)->dx == 3.0f);
+
+	CHECK(store.destroy(a));
+	CHECK(!store.alive(a));
+	CHECK(store.get<std::string>(a) == nullptr);
+}
+
+TEST_CASE("archetype-store-queries")
+{
+	archetype_store store;
+	std::vector<entity> moving = store.create_n(100, position{0, 0}, velocity{1, 2});
+	std::vector<entity> still = store.create_n(50, position{5, 5});
+	store.add<std::string>(moving[10], "tagged");
+
+	int visited = 0;
+	store.each<position, velocity>([&](position& p, velocity& v) {
+		p.x += v.dx;
+		p.y += v.dy;
+		++visited;
+	});
+	CHECK(visited == 100);
+	CHECK(store.get<position>(moving[10])->y == 2.0f);
+	CHECK(store.get<position>(still[0])->x == 5.0f);
+
+	visited = 0;
+	store.each<position>([&](entity e, position&) {
+		CHECK(store.alive(e));
+		++visited;
+	});
+	CHECK(visited == 150);
+
+	// Destroying swaps the last row into the hole; the moved entity must stay addressable.
+	CHECK(store.destroy(moving[0]));
+	CHECK(store.get<position>(moving[99])->x == 1.0f);
+	CHECK(*store.get<std::string>(moving[10]) == "tagged");
+}
+
+TEST_CASE("archetype-store-replace-keeps-component-on-throw")
+{
+	archetype_store store;
+	entity a = store.create();
+	store.add<checked_name>(a, "first");
+
+	bool thrown = false;
+	try
+	{
+		store.add<checked_name>(a, "");
+	}
+	catch (const std::invalid_argument&)
+	{
+		thrown = true;
+	}
+	CHECK(thrown);
+	CHECK(store.get<checked_name>(a)->name == "first");
+
+	// A runtime replacement is assigned over the live component.
+	any<> replacement = checked_name("second");
+	CHECK(store.add(a, std::move(replacement)) == store.get<checked_name>(a));
+	CHECK(store.get<checked_name>(a)->name == "second");
+
+	// A throw while adding a new component type leaves e where it was.
+	entity b = store.create();
+	store.add<position>(b, 1.0f, 2.0f);
+	thrown = false;
+	try
+	{
+		store.add<checked_name>(b, "");
+	}
+	catch (const std::invalid_argument&)
+	{
+		thrown = true;
+	}
+	CHECK(thrown);
+	CHECK(store.get<checked_name>(b) == nullptr);
+	CHECK(store.get<position>(b)->y == 2.0f);
+	int named = 0;
+	store.each<checked_name>([&](checked_name&) { ++named; });
+	CHECK(named == 1);
+	CHECK(store.destroy(a));
+	CHECK(store.destroy(b));
+}
+
+TEST_CASE("archetype-store-non-assignable-components")
+{
+	archetype_store store;
+	entity e = store.create();
+	CHECK(store.add<fixed>(e, 1)->id == 1);
+	CHECK(store.add<fixed>(e, 2)->id == 2);
+
+	any<> runtime_component = fixed{3};
+	CHECK(store.add(e, std::move(runtime_component)) != nullptr);
+	CHECK(store.get<fixed>(e)->id == 3);
+	CHECK(store.destroy(e));
+}
+
+TEST_CASE("archetype-store-create-n-unwinds")
+{
+	archetype_store store;
+	std::vector<entity> before = store.create_n(3, position{1, 1}, std::string("kept"));
+
+	fragile::copies_left = 2;
+	bool thrown = false;
+	try
+	{
+		store.create_n(4, position{2, 2}, std::string("dropped"), fragile{});
+	}
+	catch (const std::runtime_error&)
+	{
+		thrown = true;
+	}
+	CHECK(thrown);
+	CHECK(fragile::live == 0);
+
+	int visited = 0;
+	store.each<position>([&](entity e, position&) {
+		CHECK(store.alive(e));
+		++visited;
+	});
+	CHECK(visited == 3);
+
+	// The failed call handed out no entities; later ones are created and destroyed normally.
+	fragile::copies_left = 100;
+	std::vector<entity> after = store.create_n(2, position{3, 3}, fragile{});
+	CHECK(fragile::live == 2);
+	for (entity e : after)
+	{
+		CHECK(store.destroy(e));
+	}
+	CHECK(fragile::live == 0);
+	CHECK(store.destroy(before[0]));
+}
+
+TEST_SUITE_END();
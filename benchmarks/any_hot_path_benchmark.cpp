@@ -0,0 +1,258 @@
+// Times the operations that dominate real any workloads: construction, copies and moves
+// through any_type_operations, typed access, and containers of mixed types.
+//
+// Each line of output is "<name> <nanoseconds per operation>", which benchmarks/pgo.py
+// parses to compare optimization profiles.
+
+#include "really/any.hpp"
+#include "really/any_array.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr size_t iterations = 10'000'000;
+
+// Keeps the optimizer from discarding a benchmark's work.
+volatile size_t sink;
+
+// Makes the optimizer assume value is read and modified, so constructing it can't be elided.
+template <class T>
+void escape(T& value)
+{
+#if defined(__GNUC__)
+	asm volatile("" : : "r"(&value) : "memory");
+#else
+	static void* volatile escaped;
+	escaped = &value;
+#endif
+}
+
+struct vec3
+{
+	float x, y, z;
+};
+
+template <class F>
+void measure(const char* name, size_t operations, F&& body)
+{
+	auto start = std::chrono::steady_clock::now();
+	size_t result = body();
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	sink = result;
+	std::printf("%-28s %8.2f\n", name, elapsed.count() / static_cast<double>(operations));
+}
+
+// A mix of inline trivial, inline non-trivial and heap-stored values.
+std::vector<really::any<>> mixed_values(size_t count)
+{
+	std::vector<really::any<>> values;
+	values.reserve(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		switch (i % 4)
+		{
+		case 0:
+			values.emplace_back(static_cast<int>(i));
+			break;
+		case 1:
+			values.emplace_back(vec3{1, 2, static_cast<float>(i)});
+			break;
+		case 2:
+			values.emplace_back(std::string("short"));
+			break;
+		default:
+			values.emplace_back(std::vector<int>(4, static_cast<int>(i)));
+			break;
+		}
+	}
+	return values;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	// Only run benchmarks whose name starts with the optional filter argument.
+	const char* filter = argc > 1 ? argv[1] : "";
+	auto selected = [&](const char* name) {
+		return std::strncmp(name, filter, std::strlen(filter)) == 0;
+	};
+
+	if (selected("construct_small"))
+	{
+		measure("construct_small", iterations, [] {
+			size_t total = 0;
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				really::any<> a = static_cast<int>(i);
+				escape(a);
+				total += a.has_value();
+			}
+			return total;
+		});
+	}
+
+	if (selected("construct_heap"))
+	{
+		measure("construct_heap", iterations / 10, [] {
+			size_t total = 0;
+			for (size_t i = 0; i < iterations / 10; ++i)
+			{
+				really::any<> a = std::vector<int>(2);
+				escape(a);
+				total += a.has_value();
+			}
+			return total;
+		});
+	}
+
+	if (selected("copy_trivial"))
+	{
+		measure("copy_trivial", iterations, [] {
+			really::any<> source = vec3{1, 2, 3};
+			size_t total = 0;
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				really::any<> copy = source;
+				escape(copy);
+				total += copy.has_value();
+			}
+			return total;
+		});
+	}
+
+	if (selected("copy_string"))
+	{
+		measure("copy_string", iterations, [] {
+			really::any<> source = std::string("short");
+			size_t total = 0;
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				really::any<> copy = source;
+				escape(copy);
+				total += copy.has_value();
+			}
+			return total;
+		});
+	}
+
+	if (selected("move_inline"))
+	{
+		measure("move_inline", iterations, [] {
+			really::any<> a = vec3{1, 2, 3};
+			really::any<> b;
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				b = std::move(a);
+				escape(b);
+				a = std::move(b);
+				escape(a);
+			}
+			return static_cast<size_t>(a.has_value());
+		});
+	}
+
+	if (selected("typed_access"))
+	{
+		measure("typed_access", iterations, [] {
+			really::any<> a = static_cast<int>(1);
+			size_t total = 0;
+			for (size_t i = 0; i < iterations; ++i)
+			{
+				escape(a);
+				if (const int* value = a.try_get_value<int>())
+				{
+					total += static_cast<size_t>(*value);
+				}
+			}
+			return total;
+		});
+	}
+
+	if (selected("mixed_vector_copy"))
+	{
+		constexpr size_t count = 1024;
+		std::vector<really::any<>> values = mixed_values(count);
+		constexpr size_t rounds = iterations / count;
+		measure("mixed_vector_copy", rounds * count, [&] {
+			size_t total = 0;
+			for (size_t r = 0; r < rounds; ++r)
+			{
+				std::vector<really::any<>> copy = values;
+				escape(copy);
+				total += copy.size();
+			}
+			return total;
+		});
+	}
+
+	// Builds arrays of values too big for the inline buffer, then sums them, one allocation
+	// per value against payloads carved from one slab.
+	using block = std::array<int, 8>;
+	constexpr size_t array_size = 1024;
+	constexpr size_t array_rounds = iterations / array_size / 10;
+	auto sum_blocks = [](const std::vector<really::any<>>& values) {
+		size_t total = 0;
+		for (const really::any<>& value : values)
+		{
+			total += static_cast<size_t>((*value.try_get_value<block>())[0]);
+		}
+		return total;
+	};
+
+	if (selected("build_array_separate"))
+	{
+		std::vector<block> blocks(array_size, block{1});
+		measure("build_array_separate", array_rounds * array_size, [&] {
+			size_t total = 0;
+			for (size_t r = 0; r < array_rounds; ++r)
+			{
+				std::vector<really::any<>> values;
+				values.reserve(array_size);
+				for (const block& b : blocks)
+				{
+					values.emplace_back(b);
+				}
+				total += sum_blocks(values);
+			}
+			return total;
+		});
+	}
+
+	if (selected("build_array_slab"))
+	{
+		std::vector<block> blocks(array_size, block{1});
+		measure("build_array_slab", array_rounds * array_size, [&] {
+			size_t total = 0;
+			for (size_t r = 0; r < array_rounds; ++r)
+			{
+				total += sum_blocks(really::make_any_array(blocks));
+			}
+			return total;
+		});
+	}
+
+	if (selected("mixed_type_dispatch"))
+	{
+		constexpr size_t count = 1024;
+		std::vector<really::any<>> values = mixed_values(count);
+		constexpr size_t rounds = iterations / count;
+		measure("mixed_type_dispatch", rounds * count, [&] {
+			size_t total = 0;
+			for (size_t r = 0; r < rounds; ++r)
+			{
+				escape(values);
+				for (const really::any<>& value : values)
+				{
+					total += value.has_type<int>() + value.has_type<std::string>();
+				}
+			}
+			return total;
+		});
+	}
+}
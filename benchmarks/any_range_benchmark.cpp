@@ -0,0 +1,106 @@
+// Compares iterating a type-erased sequence one element per virtual call, as a next()-style
+// plugin interface does, against really::any_range's batched pulls, typed and into anys.
+//
+// Each line of output is "<name> <nanoseconds per element>".
+
+#include "really/any_range.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+namespace
+{
+constexpr size_t element_count = 1 << 20;
+constexpr size_t rounds = 20;
+
+volatile size_t sink;
+
+// The per-element interface any_range replaces.
+class element_source
+{
+public:
+	virtual ~element_source() = default;
+	virtual bool next(really::any<>& out) = 0;
+};
+
+class vector_element_source final : public element_source
+{
+public:
+	explicit vector_element_source(const std::vector<int>& values) : values_(values) {}
+
+	virtual bool next(really::any<>& out)
+	{
+		if (position_ == values_.size())
+		{
+			return false;
+		}
+		out = values_[position_++];
+		return true;
+	}
+
+private:
+	const std::vector<int>& values_;
+	size_t position_ = 0;
+};
+
+// Defined out of line of main's loops so the sources can't be devirtualized.
+[[gnu::noinline]] std::unique_ptr<element_source> open_elements(const std::vector<int>& values)
+{
+	return std::make_unique<vector_element_source>(values);
+}
+
+[[gnu::noinline]] really::any_range open_range(const std::vector<int>& values)
+{
+	return really::make_any_range(values);
+}
+
+template <class F>
+void measure(const char* name, F&& body)
+{
+	size_t total = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (size_t r = 0; r < rounds; ++r)
+	{
+		total += body();
+	}
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	sink = total;
+	std::printf("%-24s %8.2f\n", name,
+				elapsed.count() / static_cast<double>(rounds * element_count));
+}
+} // namespace
+
+int main()
+{
+	std::vector<int> values(element_count);
+	std::iota(values.begin(), values.end(), 0);
+
+	measure("per_element_next", [&] {
+		size_t total = 0;
+		auto source = open_elements(values);
+		really::any<> value;
+		while (source->next(value))
+		{
+			total += static_cast<size_t>(value.value<int>());
+		}
+		return total;
+	});
+
+	measure("batched_typed", [&] {
+		size_t total = 0;
+		open_range(values).for_each<int>([&](int value) { total += static_cast<size_t>(value); });
+		return total;
+	});
+
+	measure("batched_erased", [&] {
+		size_t total = 0;
+		for (really::any<>& value : open_range(values))
+		{
+			total += static_cast<size_t>(value.value<int>());
+		}
+		return total;
+	});
+}
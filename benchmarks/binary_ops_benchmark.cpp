@@ -0,0 +1,138 @@
+// Compares applying binary operators to pairs of anys through nested try_get_value chains, the
+// way a hand-written expression evaluator does, against really::binary_op_table.
+//
+// Operands are drawn from 12 arithmetic and string types, and every pair with a built-in
+// operator is supported by both. Each line of output is "<name> <nanoseconds per operation>".
+
+#include "really/binary_ops.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr size_t value_count = 1024;
+constexpr size_t rounds = 2000;
+
+volatile size_t sink;
+
+// Tries every lhs type, then every rhs type, until both match.
+template <class... T>
+struct try_get_value_chain
+{
+	template <class Op>
+	static bool apply(Op op, const really::any<>& lhs, const really::any<>& rhs,
+					  really::any<>& result)
+	{
+		return (apply_lhs<T>(op, lhs, rhs, result) || ...);
+	}
+
+	template <class L, class Op>
+	static bool apply_lhs(Op op, const really::any<>& lhs, const really::any<>& rhs,
+						  really::any<>& result)
+	{
+		const L* l = lhs.try_get_value<L>();
+		return l != nullptr && (apply_pair<L, T>(op, *l, rhs, result) || ...);
+	}
+
+	template <class L, class R, class Op>
+	static bool apply_pair(Op op, const L& l, const really::any<>& rhs, really::any<>& result)
+	{
+		if constexpr (std::is_invocable_v<Op, const L&, const R&>)
+		{
+			if (const R* r = rhs.try_get_value<R>())
+			{
+				result.emplace<std::decay_t<std::invoke_result_t<Op, const L&, const R&>>>(
+					op(l, *r));
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static void register_all(really::binary_op_registry& registry)
+	{
+		(register_lhs<T>(registry), ...);
+	}
+
+	template <class L>
+	static void register_lhs(really::binary_op_registry& registry)
+	{
+		(registry.add_builtin<L, T>(), ...);
+	}
+};
+
+using types = try_get_value_chain<int8_t, int16_t, int32_t, int64_t, uint8_t, uint16_t,
+								  uint32_t, uint64_t, float, double, long double, std::string>;
+
+std::vector<really::any<>> make_values()
+{
+	std::mt19937 rng(1);
+	std::vector<really::any<>> values;
+	for (size_t i = 0; i < value_count; ++i)
+	{
+		auto v = static_cast<int>(rng() % 100 + 1);
+		switch (rng() % 12)
+		{
+		case 0: values.emplace_back(static_cast<int8_t>(v)); break;
+		case 1: values.emplace_back(static_cast<int16_t>(v)); break;
+		case 2: values.emplace_back(static_cast<int32_t>(v)); break;
+		case 3: values.emplace_back(static_cast<int64_t>(v)); break;
+		case 4: values.emplace_back(static_cast<uint8_t>(v)); break;
+		case 5: values.emplace_back(static_cast<uint16_t>(v)); break;
+		case 6: values.emplace_back(static_cast<uint32_t>(v)); break;
+		case 7: values.emplace_back(static_cast<uint64_t>(v)); break;
+		case 8: values.emplace_back(static_cast<float>(v)); break;
+		case 9: values.emplace_back(static_cast<double>(v)); break;
+		case 10: values.emplace_back(static_cast<long double>(v)); break;
+		default: values.emplace_back(std::to_string(v)); break;
+		}
+	}
+	return values;
+}
+
+template <class F>
+void measure(const char* name, F&& apply)
+{
+	size_t applied = 0;
+	really::any<> result;
+	auto start = std::chrono::steady_clock::now();
+	for (size_t r = 0; r < rounds; ++r)
+	{
+		for (size_t i = 0; i + 1 < value_count; ++i)
+		{
+			applied += apply(i, result);
+		}
+	}
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	sink = applied;
+	std::printf("%-28s %8.2f   (%zu applied)\n", name,
+				elapsed.count() / static_cast<double>(rounds * (value_count - 1)), applied);
+}
+} // namespace
+
+int main()
+{
+	std::vector<really::any<>> values = make_values();
+
+	really::binary_op_registry registry;
+	types::register_all(registry);
+	really::binary_op_table table = registry.compile();
+
+	measure("add_try_get_value_chain", [&](size_t i, really::any<>& result) {
+		return types::apply(std::plus<>(), values[i], values[i + 1], result);
+	});
+	measure("add_dispatch_table", [&](size_t i, really::any<>& result) {
+		return table.apply(really::binary_op::add, values[i], values[i + 1], result);
+	});
+	measure("less_try_get_value_chain", [&](size_t i, really::any<>& result) {
+		return types::apply(std::less<>(), values[i], values[i + 1], result);
+	});
+	measure("less_dispatch_table", [&](size_t i, really::any<>& result) {
+		return table.apply(really::binary_op::less, values[i], values[i + 1], result);
+	});
+}
@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+"""Measures what storing many distinct types in really::any costs in compile time and code size.
+
+Generates one translation unit that stores, copies and destroys COUNT distinct payload types in
+an any<>, compiles it with and without shared operations for trivial types, and reports the
+compile time and object size of each build.
+
+    benchmarks/codesize.py [--count 1000] [--compiler c++] [--flags "-O2"]
+"""
+
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+
+def generate(count, nontrivial_every):
+    lines = ['#include "really/any.hpp"', "#include <string>", "", "namespace bench", "{"]
+    for i in range(count):
+        fields = 1 + i % 8
+        lines.append(f"struct payload_{i}")
+        lines.append("{")
+        for f in range(fields):
+            lines.append(f"\tint field_{f} = {i};")
+        if nontrivial_every and i % nontrivial_every == 0:
+            lines.append("\tstd::string name;")
+        lines.append("};")
+    lines.append("")
+    lines.append("int touch(really::any<>& a);")
+    lines.append("")
+    lines.append("int run()")
+    lines.append("{")
+    lines.append("\tint sum = 0;")
+    for i in range(count):
+        lines.append(f"\t{{ really::any<> a = payload_{i}{{}}; really::any<> b = a; "
+                     f"sum += touch(b); }}")
+    lines.append("\treturn sum;")
+    lines.append("}")
+    lines.append("} // namespace bench")
+    return "\n".join(lines) + "\n"
+
+
+def text_size(obj):
+    size_tool = shutil.which("size")
+    if size_tool is None:
+        return None
+    out = subprocess.run([size_tool, "-A", obj], capture_output=True, text=True).stdout
+    total = 0
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) >= 2 and parts[0].startswith(".text"):
+            total += int(parts[1])
+    return total
+
+
+def build(compiler, flags, source, obj, defines):
+    cmd = [compiler, "-std=c++20", "-c", source, "-o", obj, "-I", os.path.join(ROOT, "include")]
+    cmd += flags.split() + [f"-D{d}" for d in defines]
+    start = time.perf_counter()
+    subprocess.run(cmd, check=True)
+    return time.perf_counter() - start
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--count", type=int, default=1000)
+    parser.add_argument("--compiler", default=os.environ.get("CXX", "c++"))
+    parser.add_argument("--flags", default="-O2")
+    parser.add_argument("--nontrivial-every", type=int, default=10,
+                        help="make every Nth type hold a std::string (0 for none)")
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as tmp:
+        source = os.path.join(tmp, "codesize.cpp")
+        with open(source, "w") as f:
+            f.write(generate(args.count, args.nontrivial_every))
+
+        print(f"{args.count} types, {args.compiler} {args.flags}")
+        print(f"{'build':<24}{'compile s':>12}{'object bytes':>16}{'.text bytes':>14}")
+        for name, defines in (("shared trivial ops", []),
+                              ("per-type ops", ["REALLY_ANY_NO_SHARED_TRIVIAL_OPS"])):
+            obj = os.path.join(tmp, "codesize.o")
+            seconds = build(args.compiler, args.flags, source, obj, defines)
+            text = text_size(obj)
+            print(f"{name:<24}{seconds:>12.2f}{os.path.getsize(obj):>16}"
+                  f"{text if text is not None else 'n/a':>14}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
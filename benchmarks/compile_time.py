@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""Measures the per-translation-unit compile cost of including really/any.hpp versus importing
+the really.any module.
+
+Generates COUNT small translation units that each store a few types in an any, compiles them
+once with #include "really/any.hpp" and once with `import really.any;`, and reports the mean
+time per unit. The module's own build is timed separately, since it is paid once per build.
+
+    benchmarks/compile_time.py [--count 20] [--compiler g++|clang++] [--flags "-O2"]
+
+Supports GCC (-fmodules-ts) and Clang (--precompile).
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+INCLUDE = os.path.join(ROOT, "include")
+MODULE_SOURCE = os.path.join(INCLUDE, "really", "any.cppm")
+
+
+def unit_source(index, use_module, gcc):
+    body = f"""
+struct payload_{index}
+{{
+	int id = {index};
+	double weight = 1.5;
+}};
+
+int use_{index}()
+{{
+	really::any<> a = payload_{index}{{}};
+	really::any<> b = a;
+	really::heap_any<> h = {index};
+	return b.value<payload_{index}>().id + (b.type() == h.type());
+}}
+"""
+    if not use_module:
+        return '#include "really/any.hpp"\n' + body
+    # GCC 12 needs placement new declared in the importer, see any.cppm.
+    return ("#include <new>\n" if gcc else "") + "import really.any;\n" + body
+
+
+def is_gcc(compiler):
+    out = subprocess.run([compiler, "--version"], capture_output=True, text=True).stdout
+    return "clang" not in out.lower()
+
+
+def timed(cmd, cwd):
+    start = time.perf_counter()
+    subprocess.run(cmd, check=True, cwd=cwd)
+    return time.perf_counter() - start
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--count", type=int, default=20)
+    parser.add_argument("--compiler", default=os.environ.get("CXX", "c++"))
+    parser.add_argument("--flags", default="-O2")
+    args = parser.parse_args()
+
+    gcc = is_gcc(args.compiler)
+    base = [args.compiler, "-std=c++20", "-I", INCLUDE] + args.flags.split()
+
+    with tempfile.TemporaryDirectory() as tmp:
+        if gcc:
+            module_flags = ["-fmodules-ts"]
+            module_build = base + module_flags + ["-x", "c++", "-c", MODULE_SOURCE, "-o",
+                                                  "really_any.o"]
+        else:
+            pcm = os.path.join(tmp, "really.any.pcm")
+            module_flags = [f"-fmodule-file=really.any={pcm}"]
+            module_build = base + ["-x", "c++-module", "--precompile", MODULE_SOURCE, "-o", pcm]
+        module_seconds = timed(module_build, tmp)
+
+        results = {}
+        for use_module in (False, True):
+            total = 0.0
+            for i in range(args.count):
+                source = os.path.join(tmp, f"unit_{i}.cpp")
+                with open(source, "w") as f:
+                    f.write(unit_source(i, use_module, gcc))
+                cmd = base + (module_flags if use_module else []) + ["-c", source, "-o",
+                                                                     f"unit_{i}.o"]
+                total += timed(cmd, tmp)
+            results[use_module] = total / args.count
+
+    print(f"{args.count} translation units, {args.compiler} {args.flags}")
+    rows = (('#include "really/any.hpp"', results[False], "per unit"),
+            ("import really.any;", results[True], "per unit"),
+            ("building the module", module_seconds, "once"))
+    for name, seconds, unit in rows:
+        print(f"{name:<28}{seconds * 1000:>10.1f} ms {unit}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
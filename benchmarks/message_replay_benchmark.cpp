@@ -0,0 +1,442 @@
+// Replays a trace of messages through a publish/subscribe loop built on type-erased values, to
+// measure allocation, small buffer misses and dispatch together the way real traffic mixes them.
+//
+// Each message is produced into an any, copied to each of its subscribers, dispatched by type
+// by every subscriber, and destroyed with its copies. Every thread replays the whole trace.
+//
+//     message_replay_benchmark [--trace FILE] [--messages N] [--flavors any,heap_any,...]
+//                              [--threads 1,4]
+//
+// Flavors are any, heap_any, any_of_size (any_of_size<64>) and std_any; all run by default.
+// A trace file has one message per line, "<kind> <size> <subscribers>", where kind is one of
+// int, double, point, order, string or blob, and size is the string or blob length (ignored
+// for the fixed-size kinds). Without a trace, a synthetic one of N messages is used.
+//
+// Each line of output is "<flavor>_t<threads> <messages per second> <p50 ns> <p99 ns>
+// <p999 ns> <peak RSS KiB>", latencies per message. On POSIX systems every configuration runs
+// in its own child process, so peak RSS is its own; elsewhere it prints as "-".
+
+#include "really/any.hpp"
+
+#include <algorithm>
+#include <any>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define REALLY_ANY_BENCHMARK_FORK 1
+#endif
+
+namespace
+{
+volatile size_t sink;
+
+struct point
+{
+	double x, y;
+};
+
+struct order
+{
+	uint64_t id;
+	double price;
+	double quantity;
+	uint32_t side;
+	char symbol[12];
+};
+
+enum class kind : uint8_t
+{
+	integer,
+	floating,
+	point,
+	order,
+	string,
+	blob,
+};
+
+constexpr const char* kind_names[] = {"int", "double", "point", "order", "string", "blob"};
+
+struct message_event
+{
+	kind type;
+	uint32_t size;
+	uint32_t subscribers;
+};
+
+std::vector<message_event> read_trace(const char* path)
+{
+	std::vector<message_event> trace;
+	std::ifstream in(path);
+	std::string line;
+	while (std::getline(in, line))
+	{
+		std::istringstream fields(line);
+		std::string name;
+		message_event event{};
+		if (!(fields >> name >> event.size >> event.subscribers))
+		{
+			continue;
+		}
+		auto found = std::find_if(std::begin(kind_names), std::end(kind_names),
+								  [&](const char* k) { return name == k; });
+		if (found == std::end(kind_names))
+		{
+			std::fprintf(stderr, "unknown message kind '%s' in %s\n", name.c_str(), path);
+			std::exit(1);
+		}
+		event.type = static_cast<kind>(found - std::begin(kind_names));
+		trace.push_back(event);
+	}
+	return trace;
+}
+
+// Mostly small fixed-size messages, some short strings and a tail of large blobs, each with
+// one to eight subscribers.
+std::vector<message_event> synthetic_trace(size_t count)
+{
+	std::mt19937 rng(1);
+	std::vector<message_event> trace(count);
+	for (message_event& event : trace)
+	{
+		uint32_t r = rng() % 100;
+		event.subscribers = 1 + rng() % 8;
+		if (r < 35)
+		{
+			event.type = kind::integer;
+		}
+		else if (r < 45)
+		{
+			event.type = kind::floating;
+		}
+		else if (r < 65)
+		{
+			event.type = kind::point;
+		}
+		else if (r < 80)
+		{
+			event.type = kind::order;
+		}
+		else if (r < 95)
+		{
+			event.type = kind::string;
+			event.size = 4 + rng() % 60;
+		}
+		else
+		{
+			event.type = kind::blob;
+			event.size = 256 + rng() % 4096;
+		}
+	}
+	return trace;
+}
+
+template <class T, class Any>
+const T* try_get(const Any& value)
+{
+	return value.template try_get_value<T>();
+}
+
+template <class T>
+const T* try_get(const std::any& value)
+{
+	return std::any_cast<T>(&value);
+}
+
+template <class Any>
+void produce(Any& message, const message_event& event, uint64_t sequence)
+{
+	switch (event.type)
+	{
+	case kind::integer: message = static_cast<int64_t>(sequence); break;
+	case kind::floating: message = static_cast<double>(sequence); break;
+	case kind::point: message = point{1.0, static_cast<double>(sequence)}; break;
+	case kind::order: message = order{sequence, 100.5, 10.0, 1, "XYZ"}; break;
+	case kind::string: message = std::string(event.size, 's'); break;
+	case kind::blob: message = std::vector<std::byte>(event.size); break;
+	}
+}
+
+// A subscriber's handler, chosen by the message's type.
+template <class Any>
+size_t dispatch(const Any& message)
+{
+	if (const int64_t* v = try_get<int64_t>(message))
+	{
+		return static_cast<size_t>(*v);
+	}
+	if (const double* v = try_get<double>(message))
+	{
+		return static_cast<size_t>(*v);
+	}
+	if (const point* v = try_get<point>(message))
+	{
+		return static_cast<size_t>(v->y);
+	}
+	if (const order* v = try_get<order>(message))
+	{
+		return v->id + v->side;
+	}
+	if (const std::string* v = try_get<std::string>(message))
+	{
+		return v->size();
+	}
+	if (const std::vector<std::byte>* v = try_get<std::vector<std::byte>>(message))
+	{
+		return v->size();
+	}
+	return 0;
+}
+
+// Replays the trace once, recording each message's latency in nanoseconds.
+template <class Any>
+size_t replay(const std::vector<message_event>& trace, std::vector<uint32_t>& latencies)
+{
+	std::vector<Any> copies;
+	copies.reserve(16);
+	size_t total = 0;
+	uint64_t sequence = 0;
+	for (const message_event& event : trace)
+	{
+		auto start = std::chrono::steady_clock::now();
+		{
+			Any message;
+			produce(message, event, sequence++);
+			for (uint32_t s = 0; s < event.subscribers; ++s)
+			{
+				copies.emplace_back(message);
+			}
+			for (const Any& copy : copies)
+			{
+				total += dispatch(copy);
+			}
+			copies.clear();
+		}
+		auto elapsed = std::chrono::steady_clock::now() - start;
+		latencies.push_back(static_cast<uint32_t>(
+			std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+	}
+	return total;
+}
+
+uint32_t percentile(const std::vector<uint32_t>& sorted, double p)
+{
+	size_t i = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+	return sorted[i];
+}
+
+long peak_rss_kib()
+{
+#if defined(REALLY_ANY_BENCHMARK_FORK)
+	rusage usage{};
+	getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+#else
+	return -1;
+#endif
+}
+
+template <class Any>
+void run(const char* flavor, const std::vector<message_event>& trace, unsigned threads)
+{
+	std::vector<std::vector<uint32_t>> latencies(threads);
+	for (std::vector<uint32_t>& l : latencies)
+	{
+		l.reserve(trace.size());
+	}
+
+	// Threads wait for each other before replaying, so they contend for the whole run.
+	std::atomic<unsigned> ready{0};
+	std::atomic<size_t> total{0};
+	std::vector<std::thread> workers;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned t = 0; t < threads; ++t)
+	{
+		workers.emplace_back([&, t] {
+			ready.fetch_add(1);
+			while (ready.load() != threads)
+			{
+				std::this_thread::yield();
+			}
+			total.fetch_add(replay<Any>(trace, latencies[t]));
+		});
+	}
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	sink = total.load();
+
+	std::vector<uint32_t> all;
+	all.reserve(trace.size() * threads);
+	for (const std::vector<uint32_t>& l : latencies)
+	{
+		all.insert(all.end(), l.begin(), l.end());
+	}
+	std::sort(all.begin(), all.end());
+
+	char name[64];
+	std::snprintf(name, sizeof(name), "%s_t%u", flavor, threads);
+	std::printf("%-24s %12.0f %8u %8u %8u", name, static_cast<double>(all.size()) / elapsed.count(),
+				percentile(all, 0.5), percentile(all, 0.99), percentile(all, 0.999));
+	long rss = peak_rss_kib();
+	if (rss >= 0)
+	{
+		std::printf(" %10ld\n", rss);
+	}
+	else
+	{
+		std::printf(" %10s\n", "-");
+	}
+	std::fflush(stdout);
+}
+
+// Runs one configuration, in a child process where possible so its peak RSS is its own.
+template <class Any>
+void run_isolated(const char* flavor, const std::vector<message_event>& trace, unsigned threads)
+{
+#if defined(REALLY_ANY_BENCHMARK_FORK)
+	pid_t child = fork();
+	if (child == 0)
+	{
+		run<Any>(flavor, trace, threads);
+		// exit rather than _Exit, so an instrumented (pgo-generate) build writes its profile.
+		std::exit(0);
+	}
+	if (child > 0)
+	{
+		int status = 0;
+		waitpid(child, &status, 0);
+		return;
+	}
+#endif
+	run<Any>(flavor, trace, threads);
+}
+
+std::vector<std::string> split(const char* list)
+{
+	std::vector<std::string> items;
+	std::istringstream in(list);
+	std::string item;
+	while (std::getline(in, item, ','))
+	{
+		items.push_back(item);
+	}
+	return items;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	const char* trace_path = nullptr;
+	size_t messages = 200'000;
+	const char* flavors = "any,heap_any,any_of_size,std_any";
+	const char* thread_counts = "1,4";
+	for (int i = 1; i < argc; i += 2)
+	{
+		const bool known = std::strcmp(argv[i], "--trace") == 0 ||
+			std::strcmp(argv[i], "--messages") == 0 || std::strcmp(argv[i], "--flavors") == 0 ||
+			std::strcmp(argv[i], "--threads") == 0;
+		if (!known)
+		{
+			std::fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+		if (i + 1 == argc)
+		{
+			std::fprintf(stderr, "option %s needs a value\n", argv[i]);
+			return 1;
+		}
+		if (std::strcmp(argv[i], "--trace") == 0)
+		{
+			trace_path = argv[i + 1];
+		}
+		else if (std::strcmp(argv[i], "--messages") == 0)
+		{
+			messages = std::strtoull(argv[i + 1], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--flavors") == 0)
+		{
+			flavors = argv[i + 1];
+		}
+		else
+		{
+			thread_counts = argv[i + 1];
+		}
+	}
+
+	std::vector<unsigned> threads_list;
+	for (const std::string& item : split(thread_counts))
+	{
+		char* end = nullptr;
+		unsigned long threads = std::strtoul(item.c_str(), &end, 10);
+		if (item.empty() || *end != '\0' || threads == 0 || threads > 1024)
+		{
+			std::fprintf(stderr, "invalid thread count '%s'\n", item.c_str());
+			return 1;
+		}
+		threads_list.push_back(static_cast<unsigned>(threads));
+	}
+	if (threads_list.empty())
+	{
+		std::fprintf(stderr, "no thread counts\n");
+		return 1;
+	}
+
+	std::vector<message_event> trace =
+		trace_path != nullptr ? read_trace(trace_path) : synthetic_trace(messages);
+	if (trace.empty())
+	{
+		std::fprintf(stderr, "empty trace\n");
+		return 1;
+	}
+
+	std::printf("%-24s %12s %8s %8s %8s %10s\n", "# flavor", "msgs/s", "p50", "p99", "p999",
+				"rss_kib");
+	std::fflush(stdout);
+	for (unsigned threads : threads_list)
+	{
+		for (const std::string& flavor : split(flavors))
+		{
+			if (flavor == "any")
+			{
+				run_isolated<really::any<>>("any", trace, threads);
+			}
+			else if (flavor == "heap_any")
+			{
+				run_isolated<really::heap_any<>>("heap_any", trace, threads);
+			}
+			else if (flavor == "any_of_size")
+			{
+				run_isolated<really::any_of_size<64>>("any_of_size_64", trace, threads);
+			}
+			else if (flavor == "std_any")
+			{
+				run_isolated<std::any>("std_any", trace, threads);
+			}
+			else
+			{
+				std::fprintf(stderr, "unknown flavor %s\n", flavor.c_str());
+				return 1;
+			}
+		}
+	}
+}
@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+"""Builds the benchmarks with each optimization profile and reports the speedup on any's hot
+paths.
+
+    benchmarks/pgo.py [--build-dir build-pgo] [--compiler clang++] [--repeat 3]
+
+Profiles:
+  baseline  Release flags only
+  thinlto   REALLY_ANY_OPTIMIZATION=thinlto
+  pgo       instrumented build (pgo-generate), trained by running every benchmark workload,
+            then rebuilt in place with pgo-use, which also enables LTO
+
+The PGO build is reconfigured in one directory because GCC matches profiles to object files
+by path. Each profile's any_hot_path_benchmark runs --repeat times and the best time per
+operation is kept.
+"""
+
+import argparse
+import glob
+import os
+import shutil
+import subprocess
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+# Every benchmark trains the PGO profile, with these arguments, so the profile covers the
+# range, container, binary operation and replay paths as well as the single-value hot path.
+# The replay trains on a shorter trace with the same mix of messages.
+TRAINING = {
+    "any_hot_path_benchmark": [],
+    "any_range_benchmark": [],
+    "binary_ops_benchmark": [],
+    "container_layout_benchmark": [],
+    "message_replay_benchmark": ["--messages", "50000"],
+    "timer_wheel_benchmark": [],
+}
+BENCHMARKS = list(TRAINING)
+
+
+def run(cmd, **kwargs):
+    print("+ " + " ".join(cmd), flush=True)
+    return subprocess.run(cmd, check=True, **kwargs)
+
+
+def configure_and_build(build_dir, profile, args):
+    cmd = ["cmake", "-S", ROOT, "-B", build_dir, "-DCMAKE_BUILD_TYPE=Release",
+           "-DREALLY_ANY_BUILD_TESTS=OFF", f"-DREALLY_ANY_OPTIMIZATION={profile}"]
+    if args.compiler:
+        cmd.append(f"-DCMAKE_CXX_COMPILER={args.compiler}")
+    run(cmd, stdout=subprocess.DEVNULL)
+    run(["cmake", "--build", build_dir, "-j", str(os.cpu_count() or 1), "--target"] + BENCHMARKS,
+        stdout=subprocess.DEVNULL)
+
+
+def executable(build_dir, name):
+    return os.path.join(build_dir, "benchmarks", name)
+
+
+def measure(build_dir, repeat):
+    best = {}
+    for _ in range(repeat):
+        out = subprocess.run([executable(build_dir, "any_hot_path_benchmark")], check=True,
+                             capture_output=True, text=True).stdout
+        for line in out.splitlines():
+            name, ns = line.split()
+            best[name] = min(best.get(name, float("inf")), float(ns))
+    return best
+
+
+def is_clang(build_dir):
+    with open(os.path.join(build_dir, "CMakeCache.txt")) as cache:
+        for line in cache:
+            if line.startswith("CMAKE_CXX_COMPILER_ID:"):
+                return "Clang" in line
+    return False
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--build-dir", default=os.path.join(ROOT, "build-pgo"))
+    parser.add_argument("--compiler", default=os.environ.get("CXX"))
+    parser.add_argument("--repeat", type=int, default=3)
+    args = parser.parse_args()
+
+    results = {}
+    for profile in ("baseline", "thinlto"):
+        build_dir = os.path.join(args.build_dir, profile)
+        configure_and_build(build_dir, "none" if profile == "baseline" else profile, args)
+        results[profile] = measure(build_dir, args.repeat)
+
+    build_dir = os.path.join(args.build_dir, "pgo")
+    profile_dir = os.path.join(build_dir, "pgo-profiles")
+    shutil.rmtree(profile_dir, ignore_errors=True)
+    configure_and_build(build_dir, "pgo-generate", args)
+    for name, training_args in TRAINING.items():
+        run([executable(build_dir, name)] + training_args, stdout=subprocess.DEVNULL)
+    if is_clang(build_dir):
+        run(["llvm-profdata", "merge", "-output", os.path.join(profile_dir, "merged.profdata")] +
+            glob.glob(os.path.join(profile_dir, "*.profraw")))
+    configure_and_build(build_dir, "pgo-use", args)
+    results["pgo"] = measure(build_dir, args.repeat)
+
+    baseline = results["baseline"]
+    print(f"\n{'ns per operation':<24}{'baseline':>10}{'thinlto':>18}{'pgo':>18}")
+    for name, base_ns in baseline.items():
+        row = f"{name:<24}{base_ns:>10.2f}"
+        for profile in ("thinlto", "pgo"):
+            ns = results[profile][name]
+            row += f"{ns:>10.2f} ({base_ns / max(ns, 0.01):4.2f}x)"
+        print(row)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,148 @@
+// Compares really::timer_wheel against a binary-heap scheduler of std::function callbacks
+// with 10^6 active timers.
+//
+// The workload mimics connection timeouts: every timer carries a small payload, most are
+// cancelled and rescheduled before they fire, and the rest expire while the clock advances
+// one tick at a time.
+
+#include "really/timer_wheel.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <queue>
+#include <random>
+#include <vector>
+
+namespace
+{
+constexpr size_t timer_count = 1'000'000;
+constexpr size_t churn_count = 1'000'000;
+constexpr uint64_t max_timeout = 1 << 20;
+
+struct timeout_payload
+{
+	uint64_t connection;
+	uint32_t attempt;
+	uint64_t* fired;
+
+	void operator()() const { *fired += connection + attempt; }
+};
+
+// A typical heap scheduler. Cancelled timers stay in the heap and are skipped when popped.
+class heap_scheduler
+{
+public:
+	size_t schedule_at(uint64_t tick, std::function<void()> f)
+	{
+		size_t id = callbacks_.size();
+		callbacks_.push_back(std::move(f));
+		heap_.push({tick, id});
+		return id;
+	}
+
+	void cancel(size_t id) { callbacks_[id] = nullptr; }
+
+	size_t advance_to(uint64_t tick)
+	{
+		size_t fired = 0;
+		while (!heap_.empty() && heap_.top().tick <= tick)
+		{
+			std::function<void()>& f = callbacks_[heap_.top().id];
+			heap_.pop();
+			if (f)
+			{
+				f();
+				f = nullptr;
+				++fired;
+			}
+		}
+		return fired;
+	}
+
+private:
+	struct entry
+	{
+		uint64_t tick;
+		size_t id;
+
+		bool operator>(const entry& other) const { return tick > other.tick; }
+	};
+
+	std::priority_queue<entry, std::vector<entry>, std::greater<>> heap_;
+	std::vector<std::function<void()>> callbacks_;
+};
+
+struct result
+{
+	double schedule_ms;
+	double churn_ms;
+	double expire_ms;
+	uint64_t checksum;
+};
+
+double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+		.count();
+}
+
+template <class Scheduler, class Handle>
+result run(Scheduler& scheduler, std::vector<Handle>& handles)
+{
+	std::mt19937_64 rng(1);
+	uint64_t fired = 0;
+	result r{};
+
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < timer_count; ++i)
+	{
+		handles[i] = scheduler.schedule_at(rng() % max_timeout, timeout_payload{i, 0, &fired});
+	}
+	r.schedule_ms = elapsed_ms(start);
+
+	start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < churn_count; ++i)
+	{
+		size_t victim = rng() % timer_count;
+		scheduler.cancel(handles[victim]);
+		handles[victim] = scheduler.schedule_at(
+			rng() % max_timeout, timeout_payload{victim, static_cast<uint32_t>(i), &fired});
+	}
+	r.churn_ms = elapsed_ms(start);
+
+	start = std::chrono::steady_clock::now();
+	for (uint64_t tick = 0; tick < max_timeout; ++tick)
+	{
+		scheduler.advance_to(tick);
+	}
+	r.expire_ms = elapsed_ms(start);
+	r.checksum = fired;
+	return r;
+}
+
+void report(const char* name, const result& r)
+{
+	std::printf("%-14s schedule %8.1f ms   cancel+reschedule %8.1f ms   expire %8.1f ms   "
+				"(checksum %llu)\n",
+				name, r.schedule_ms, r.churn_ms, r.expire_ms,
+				static_cast<unsigned long long>(r.checksum));
+}
+} // namespace
+
+int main()
+{
+	std::printf("%zu timers, %zu cancel+reschedule, deadlines in [0, %llu) ticks\n",
+				timer_count, churn_count, static_cast<unsigned long long>(max_timeout));
+
+	{
+		auto wheel = std::make_unique<really::timer_wheel<>>();
+		std::vector<really::timer_handle> handles(timer_count);
+		report("timer_wheel", run(*wheel, handles));
+	}
+	{
+		heap_scheduler heap;
+		std::vector<size_t> handles(timer_count);
+		report("heap", run(heap, handles));
+	}
+}
@@ -0,0 +1,75 @@
+#include "doctest/doctest.h"
+#include "really/binary_ops.hpp"
+
+#include <string>
+
+using namespace really;
+
+TEST_SUITE_BEGIN("binary_ops");
+
+TEST_CASE("binary-ops-direct-and-promoted")
+{
+	binary_op_registry registry;
+	registry.add_builtin<int>();
+	registry.add_builtin<double>();
+	registry.add_builtin<std::string>();
+	registry.promote<int, double>();
+	registry.add<std::string, int>(binary_op::multiply, [](const std::string& s, int n) {
+		std::string result;
+		for (int i = 0; i < n; ++i)
+		{
+			result += s;
+		}
+		return result;
+	});
+	binary_op_table table = registry.compile();
+
+	any<> result;
+	REQUIRE(table.apply(binary_op::add, any<>(2), any<>(3), result));
+	CHECK(result.value<int>() == 5);
+	REQUIRE(table.apply(binary_op::modulo, any<>(7), any<>(4), result));
+	CHECK(result.value<int>() == 3);
+
+	// Mixed int and double promote the int, on either side.
+	REQUIRE(table.apply(binary_op::multiply, any<>(2), any<>(1.5), result));
+	CHECK(result.value<double>() == 3.0);
+	REQUIRE(table.apply(binary_op::less, any<>(2.5), any<>(3), result));
+	CHECK(result.value<bool>());
+
+	REQUIRE(table.apply(binary_op::add, any<>(std::string("ab")), any<>(std::string("c")), result));
+	CHECK(result.value<std::string>() == "abc");
+	REQUIRE(table.apply(binary_op::multiply, any<>(std::string("ab")), any<>(2), result));
+	CHECK(result.value<std::string>() == "abab");
+
+	// No built-in operator and no path through promotions.
+	CHECK(!table.apply(binary_op::modulo, any<>(1.0), any<>(2.0), result));
+	CHECK(!table.apply(binary_op::add, any<>(std::string("a")), any<>(1), result));
+	CHECK(!table.apply(binary_op::add, any<>(1L), any<>(1), result));
+	CHECK(!table.apply(binary_op::add, any<>(), any<>(1), result));
+	CHECK(table.supports(binary_op::subtract, get_type_info<int>(), get_type_info<double>()));
+	CHECK(!table.supports(binary_op::modulo, get_type_info<int>(), get_type_info<double>()));
+}
+
+TEST_CASE("binary-ops-direct-beats-promotion")
+{
+	binary_op_registry registry;
+	registry.add_builtin<double>();
+	registry.promote<int, double>();
+	registry.promote<float, double>();
+	registry.add<int, float>(binary_op::add, [](int, float) { return std::string("direct"); });
+	binary_op_table table = registry.compile();
+
+	any<> result;
+	REQUIRE(table.apply(binary_op::add, any<>(1), any<>(2.0f), result));
+	CHECK(result.value<std::string>() == "direct");
+	// Both operands promoted.
+	REQUIRE(table.apply(binary_op::subtract, any<>(1), any<>(2.0f), result));
+	CHECK(result.value<double>() == -1.0);
+
+	// Tables are snapshots; later registrations need a new compile.
+	registry.add_builtin<int>();
+	REQUIRE(table.apply(binary_op::add, any<>(1), any<>(2), result));
+	CHECK(result.has_type<double>());
+	REQUIRE(registry.compile().apply(binary_op::add, any<>(1), any<>(2), result));
+	CHECK(result.value<int>() == 3);
+}
@@ -0,0 +1,103 @@
+#include "doctest/doctest.h"
+#include "really/combinable.hpp"
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace really;
+
+namespace
+{
+using histogram = std::array<uint32_t, 16>;
+
+struct no_default
+{
+	explicit no_default(int v) : value(v) {}
+
+	int value;
+};
+} // namespace
+
+TEST_SUITE_BEGIN("combinable");
+
+TEST_CASE("combinable-per-thread-reduction")
+{
+	// The type comes from an operations table, as it would for a runtime-typed stage.
+	combinable partials(get_type_operations<histogram>());
+	constexpr int thread_count = 8;
+	constexpr uint32_t per_thread = 10000;
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < thread_count; ++t)
+	{
+		threads.emplace_back([&] {
+			for (uint32_t i = 0; i < per_thread; ++i)
+			{
+				++partials.local<histogram>()[i % 16];
+			}
+		});
+	}
+	for (std::thread& t : threads)
+	{
+		t.join();
+	}
+	CHECK(partials.size() == thread_count);
+
+	any<> total = partials.combine([](void* into, const void* part) {
+		auto& sum = *static_cast<histogram*>(into);
+		const auto& add = *static_cast<const histogram*>(part);
+		for (size_t i = 0; i < sum.size(); ++i)
+		{
+			sum[i] += add[i];
+		}
+	});
+	REQUIRE(total.has_type<histogram>());
+	CHECK(total.value<histogram>()[3] == thread_count * per_thread / 16);
+
+	size_t slots = 0;
+	partials.for_each([&](void* value) {
+		CHECK((reinterpret_cast<uintptr_t>(value) % detail::cache_line_size) == 0);
+		++slots;
+	});
+	CHECK(slots == thread_count);
+}
+
+TEST_CASE("combinable-typed-and-clear")
+{
+	combinable counts = combinable::of<long>();
+	CHECK(counts.combine<long>([](long a, long b) { return a + b; }) == 0);
+
+	counts.local<long>() += 5;
+	CHECK(&counts.local<long>() == &counts.local<long>());
+	std::thread([&] { counts.local<long>() += 7; }).join();
+	CHECK(counts.combine<long>([](long a, long b) { return a + b; }) == 12);
+
+	// Cleared slots are recreated from scratch, even by threads that cached the old ones.
+	counts.clear();
+	CHECK(counts.size() == 0);
+	CHECK(counts.local<long>() == 0);
+	CHECK(counts.size() == 1);
+
+	combinable other = combinable::of<long>();
+	other.local<long>() = 1;
+	CHECK(counts.local<long>() == 0);
+}
+
+TEST_CASE("combinable-rejects-non-default-constructible")
+{
+	combinable partials(get_type_operations<no_default>());
+	bool rejected = false;
+	try
+	{
+		partials.local();
+	}
+	catch (const std::invalid_argument&)
+	{
+		rejected = true;
+	}
+	CHECK(rejected);
+	CHECK(partials.size() == 0);
+}
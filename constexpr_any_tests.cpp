@@ -0,0 +1,76 @@
+#include "doctest/doctest.h"
+#include "really/constexpr_any.hpp"
+
+#include <array>
+#include <string>
+#include <string_view>
+
+using namespace really;
+
+namespace
+{
+struct setting
+{
+	std::string_view key;
+	constexpr_any value;
+};
+
+constexpr std::array<setting, 3> default_settings()
+{
+	return {{
+		{"port", 8080},
+		{"host", std::string("localhost")},
+		{"ratio", 0.5},
+	}};
+}
+
+template <class T>
+consteval T default_setting(std::string_view key)
+{
+	for (const setting& s : default_settings())
+	{
+		if (s.key == key)
+		{
+			return s.value.value<T>();
+		}
+	}
+	return T();
+}
+
+constexpr bool copies_and_reassigns()
+{
+	constexpr_any a = std::string("abc");
+	constexpr_any b = a;
+	b.value<std::string>() += "d";
+	a = std::move(b);
+	a.emplace<int>(3);
+	return a.has_type<int>() && !b.has_value() && a.try_get_value<std::string>() == nullptr;
+}
+} // namespace
+
+TEST_SUITE_BEGIN("constexpr_any");
+
+TEST_CASE("constexpr-any-compile-time-table")
+{
+	constexpr int port = default_setting<int>("port");
+	static_assert(port == 8080);
+	// Values that allocate themselves, like strings, are only usable within the evaluation.
+	static_assert(default_settings()[1].value.value<std::string>() == "localhost");
+	static_assert(default_setting<double>("ratio") == 0.5);
+	static_assert(copies_and_reassigns());
+	static_assert(constexpr_any(1).type() == get_type_info<int>());
+	static_assert(get_type_info<int>().hash_code() != get_type_info<long>().hash_code());
+}
+
+TEST_CASE("constexpr-any-runtime")
+{
+	CHECK(copies_and_reassigns());
+
+	std::array<setting, 3> settings = default_settings();
+	CHECK(settings[1].value.value<std::string>() == "localhost");
+	CHECK(settings[0].value.try_get_value<double>() == nullptr);
+
+	any<> converted = settings[1].value.to_any();
+	CHECK(*converted.try_get_value<std::string>() == "localhost");
+	CHECK(!constexpr_any().to_any().has_value());
+}
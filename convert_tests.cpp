@@ -0,0 +1,53 @@
+#include "doctest/doctest.h"
+#include "really/convert.hpp"
+
+#include <string>
+
+using namespace really;
+
+namespace
+{
+struct fixed_point
+{
+	long long raw;
+};
+} // namespace
+
+TEST_SUITE_BEGIN("convert");
+
+TEST_CASE("any-convert-direct-and-chained")
+{
+	conversion_registry registry;
+	registry.add<int, double>();
+	registry.add<float, double>();
+	registry.add<fixed_point, float>([](const fixed_point& f) { return f.raw / 256.0f; });
+	registry.add<std::string, int>([](const std::string& s) { return std::stoi(s); });
+
+	CHECK(any_convert<double>(any<>(3), registry) == 3.0);
+	CHECK(any_convert<double>(any<>(2.5f), registry) == 2.5);
+	CHECK(any_convert<double>(any<>(4.0), registry) == 4.0);
+
+	// Two and three step chains.
+	CHECK(any_convert<double>(any<>(fixed_point{512}), registry) == 2.0);
+	CHECK(any_convert<double>(any<>(std::string("42")), registry) == 42.0);
+
+	// Repeated conversions hit the cache and give the same answer.
+	for (int i = 0; i < 3; ++i)
+	{
+		CHECK(any_convert<double>(any<>(std::string("7")), registry) == 7.0);
+	}
+
+	CHECK(!any_convert<std::string>(any<>(3), registry).has_value());
+	CHECK(!any_convert<double>(any<>(), registry).has_value());
+}
+
+TEST_CASE("any-convert-registration-invalidates-cache")
+{
+	conversion_registry registry;
+	CHECK(!any_convert<long>(any<>(1), registry).has_value());
+
+	registry.add<int, long>();
+	CHECK(any_convert<long>(any<>(1), registry) == 1L);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,189 @@
+#include "doctest/doctest.h"
+#include "really/dynamic_struct.hpp"
+
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+using namespace really;
+
+namespace
+{
+struct counted
+{
+	static inline int live = 0;
+
+	counted() { ++live; }
+	counted(const counted&) { ++live; }
+	counted& operator=(const counted&) = default;
+	~counted() { --live; }
+};
+
+struct no_default
+{
+	explicit no_default(int v) : value(v) {}
+
+	int value;
+};
+
+// Copyable, but not assignable.
+struct fixed_id
+{
+	const int id = 0;
+};
+
+// Whether f throws std::invalid_argument.
+template <class F>
+bool rejects(F&& f)
+{
+	try
+	{
+		f();
+	}
+	catch (const std::invalid_argument&)
+	{
+		return true;
+	}
+	return false;
+}
+} // namespace
+
+TEST_SUITE_BEGIN("dynamic_struct");
+
+TEST_CASE("schema-layout")
+{
+	schema s{
+		{"flag", &get_type_operations<char>()},
+		{"value", &get_type_operations<double>()},
+		{"count", &get_type_operations<int>()},
+	};
+
+	CHECK(s.field_count() == 3);
+	CHECK(s.alignment() == alignof(double));
+	CHECK(s.size() == 16);
+	CHECK(s.field_at(s.index_of("value")).offset == 0);
+	CHECK(s.index_of("missing") == SIZE_MAX);
+	for (size_t i = 0; i < s.field_count(); ++i)
+	{
+		CHECK(s.field_at(i).offset % s.field_at(i).ops->alignment() == 0);
+	}
+
+	CHECK(s.find<double>("value").valid());
+	CHECK(!s.find<int>("value").valid());
+}
+
+TEST_CASE("record-lifetime")
+{
+	schema s{
+		{"name", &get_type_operations<std::string>()},
+		{"id", &get_type_operations<int>()},
+	};
+	field_ref<std::string> name = s.find<std::string>("name");
+	field_ref<int> id = s.find<int>("id");
+
+	record a(s);
+	CHECK(a[name].empty());
+	a[name] = "a fairly long name that will not fit in the small string buffer";
+	a[id] = 7;
+
+	record b = a;
+	CHECK(b[name] == a[name]);
+	CHECK(*b.get<int>("id") == 7);
+	CHECK(b.get<double>("id") == nullptr);
+
+	record c = std::move(b);
+	CHECK(c[id] == 7);
+
+	record_array batch(s);
+	for (int i = 0; i < 20; ++i)
+	{
+		record_view r = batch.emplace_back();
+		r[id] = i;
+	}
+	batch.push_back(a.view());
+	CHECK(batch.size() == 21);
+	CHECK(batch[20][name] == a[name]);
+
+	int sum = 0;
+	batch.for_each(id, [&](int& value) { sum += value; });
+	CHECK(sum == 190 + 7);
+}
+
+TEST_CASE("record-rejects-non-default-constructible-field")
+{
+	schema s{
+		{"first", &get_type_operations<counted>()},
+		{"second", &get_type_operations<no_default>()},
+	};
+
+	bool rejected = false;
+	try
+	{
+		record r(s);
+	}
+	catch (const std::invalid_argument&)
+	{
+		rejected = true;
+	}
+	CHECK(rejected);
+	CHECK(counted::live == 0);
+
+	record_array batch(s);
+	rejected = false;
+	try
+	{
+		batch.emplace_back();
+	}
+	catch (const std::invalid_argument&)
+	{
+		rejected = true;
+	}
+	CHECK(rejected);
+	CHECK(batch.size() == 0);
+	CHECK(counted::live == 0);
+}
+
+TEST_CASE("record-copy-and-move-check-field-types")
+{
+	schema move_only{
+		{"kept", &get_type_operations<counted>()},
+		{"owner", &get_type_operations<std::unique_ptr<int>>()},
+	};
+	CHECK(move_only.construct_support() == any_copy_support::move_only);
+	{
+		record r(move_only);
+		CHECK(rejects([&] { record copy = r; }));
+		CHECK(counted::live == 1);
+
+		// Move-only fields can still be relocated as the array grows.
+		record_array batch(move_only);
+		for (int i = 0; i < 20; ++i)
+		{
+			batch.emplace_back();
+		}
+		CHECK(rejects([&] { batch.push_back(r.view()); }));
+		CHECK(batch.size() == 20);
+	}
+	CHECK(counted::live == 0);
+
+	// Without assignment, a record is assigned by copying.
+	schema constant{{"id", &get_type_operations<fixed_id>()}};
+	CHECK(constant.assign_support() == any_copy_support::no_copy_or_move);
+	record a(constant);
+	record b(constant);
+	b = a;
+	CHECK(b.get<fixed_id>("id")->id == 0);
+
+	schema pinned{{"lock", &get_type_operations<std::mutex>()}};
+	record_array locks(pinned);
+	CHECK(rejects([&] {
+		for (int i = 0; i < 100; ++i)
+		{
+			locks.emplace_back();
+		}
+	}));
+	CHECK(locks.size() == 8);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,37 @@
+// The really.any named module.
+//
+// It exports everything really/any.hpp declares, so `import really.any;` can replace the
+// include. Configuration macros such as REALLY_ANY_HASH_ONLY_TYPE_INFO must be defined when
+// the module itself is built, since macros do not cross an import.
+//
+// GCC 12 does not let template instantiations in an importer see placement new from the
+// global module fragment below, so translation units importing this with GCC should include
+// <new> before the import.
+module;
+
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if defined(REALLY_ANY_HASH_ONLY_TYPE_INFO) && !defined(NDEBUG)
+#include <mutex>
+#include <unordered_map>
+#endif
+
+#if defined(REALLY_ANY_ENABLE_USDT) && __has_include(<sys/sdt.h>)
+// really/any.hpp guards its probes with semaphores, which sdt.h only sets up when asked first.
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+#endif
+
+export module really.any;
+
+#define REALLY_ANY_EXPORT export
+#include "really/any.hpp"
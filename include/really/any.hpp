@@ -1,14 +1,82 @@
 #pragma once
 
-#include <algorithm>
 #include <cassert>
 #include <concepts>
+#include <cstddef>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <new>
 #include <string_view>
 #include <type_traits>
+#include <utility>
 
+#if defined(REALLY_ANY_HASH_ONLY_TYPE_INFO) && !defined(NDEBUG)
+#include <mutex>
+#include <unordered_map>
+#endif
+
+// Static tracepoints for perf and bpftrace (see tools/*.bt), added with REALLY_ANY_ENABLE_USDT on
+// platforms with <sys/sdt.h>. Each probe has a semaphore that tracers raise while attached, and
+// its arguments are only worked out then, so an unattached probe costs a load and a branch.
+// Without the macro or the header, probes compile to nothing.
+//
+// sdt.h reads _SDT_HAS_SEMAPHORES once, so with USDT on, include this header before anything
+// else that includes <sys/sdt.h>, or define _SDT_HAS_SEMAPHORES for the whole build.
+#if defined(REALLY_ANY_ENABLE_USDT) && __has_include(<sys/sdt.h>)
+#define REALLY_ANY_USDT 1
+#if defined(_SYS_SDT_H) && !defined(_SDT_HAS_SEMAPHORES)
+#error "<sys/sdt.h> was included without _SDT_HAS_SEMAPHORES before really/any.hpp"
+#endif
+#ifndef _SDT_HAS_SEMAPHORES
+#define _SDT_HAS_SEMAPHORES 1
+#endif
+#include <sys/sdt.h>
 
-namespace really
+// One semaphore per probe, with C linkage so the probe notes find it by name, and inline so
+// every translation unit shares it.
+#define REALLY_ANY_SEMAPHORE(probe)                                                                \
+	inline unsigned short really_any_##probe##_semaphore __attribute__((unused, section(".probes")))
+extern "C"
+{
+REALLY_ANY_SEMAPHORE(emplace);
+REALLY_ANY_SEMAPHORE(copy);
+REALLY_ANY_SEMAPHORE(move);
+REALLY_ANY_SEMAPHORE(swap);
+REALLY_ANY_SEMAPHORE(reset);
+REALLY_ANY_SEMAPHORE(heap_allocate);
+REALLY_ANY_SEMAPHORE(heap_free);
+}
+#undef REALLY_ANY_SEMAPHORE
+
+#define REALLY_ANY_PROBE_ENABLED(probe) __builtin_expect(really_any_##probe##_semaphore != 0, 0)
+#define REALLY_ANY_PROBE(probe, ...)                                                               \
+	do                                                                                             \
+	{                                                                                              \
+		if (REALLY_ANY_PROBE_ENABLED(probe))                                                       \
+		{                                                                                          \
+			STAP_PROBEV(really_any, probe, __VA_ARGS__);                                           \
+		}                                                                                          \
+	} while (false)
+#else
+#define REALLY_ANY_PROBE_ENABLED(probe) false
+#define REALLY_ANY_PROBE(probe, ...) static_cast<void>(0)
+#endif
+
+// Probe arguments for the value an any_base holds: type hash, type name, size, whether it is on
+// the heap, and the type name's length (names are not null-terminated).
+#define REALLY_ANY_PROBE_VALUE(probe)                                                              \
+	REALLY_ANY_PROBE(probe, trace_type().hash_code(), trace_type().name().data(),                  \
+					 any_ops_ != nullptr ? any_ops_->size() : 0, trace_on_heap(),                  \
+					 trace_type().name().size())
+
+// really/any.cppm defines this as export to build the really.any module from this header.
+#ifndef REALLY_ANY_EXPORT
+#define REALLY_ANY_EXPORT
+#endif
+
+
+REALLY_ANY_EXPORT namespace really
 {
 
 // get string_view of a typename
@@ -25,11 +93,11 @@ constexpr std::string_view raw_type_name()
 #endif
 }
 
-constexpr auto test_name = raw_type_name<double>();
-constexpr size_t prefix_length = test_name.find("double");
+inline constexpr auto test_name = raw_type_name<double>();
+inline constexpr size_t prefix_length = test_name.find("double");
 static_assert(prefix_length != std::string_view::npos,
 			  "cannot extract typename from function signature");
-constexpr size_t suffix_length =
+inline constexpr size_t suffix_length =
 	test_name.size() - prefix_length - std::string_view("double").size();
 } // namespace typename_impl
 
@@ -42,16 +110,127 @@ consteval std::string_view type_name()
 							name.size() - prefix_length - suffix_length);
 }
 
+// FNV-1a of a type name, so it is stable across modules and usable at compile time.
+constexpr uint64_t type_name_hash(std::string_view name)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (char c : name)
+	{
+		hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+	}
+	return hash;
+}
+
+#if defined(REALLY_ANY_HASH_ONLY_TYPE_INFO) && !defined(NDEBUG)
+namespace typename_impl
+{
+// Debug builds of the hash-only mode keep every used type's name by hash, so that name()
+// still works and a hash shared by two different names is caught when the second is used.
+struct name_registry
+{
+	std::mutex mutex;
+	std::unordered_map<uint64_t, std::string_view> names;
+
+	static name_registry& get()
+	{
+		static name_registry registry;
+		return registry;
+	}
+
+	bool add(uint64_t hash, std::string_view name)
+	{
+		std::lock_guard lock(mutex);
+		auto [it, inserted] = names.emplace(hash, name);
+		assert((inserted || it->second == name) && "really::type_info hash collision");
+		return true;
+	}
+
+	std::string_view find(uint64_t hash)
+	{
+		std::lock_guard lock(mutex);
+		auto it = names.find(hash);
+		return it != names.end() ? it->second : std::string_view();
+	}
+};
+
+template <class T>
+void register_name()
+{
+	static const bool registered =
+		name_registry::get().add(type_name_hash(type_name<T>()), type_name<T>());
+	(void)registered;
+}
+} // namespace typename_impl
+#endif
+
 
 // A std::type_info replacement that works across DLL/so boundaries
+//
+// Defining REALLY_ANY_HASH_ONLY_TYPE_INFO reduces it to the 64-bit hash of the type's name:
+// comparisons become one integer compare and release binaries no longer contain the names.
+// name() is then only available in debug builds, and is empty otherwise.
+#ifdef REALLY_ANY_HASH_ONLY_TYPE_INFO
+class type_info
+{
+public:
+	std::string_view name() const noexcept
+	{
+#ifndef NDEBUG
+		return typename_impl::name_registry::get().find(hash_);
+#else
+		return {};
+#endif
+	}
+
+	inline constexpr size_t hash_code() const noexcept { return static_cast<size_t>(hash_); }
+
+	inline constexpr bool operator==(const type_info& other) const noexcept
+	{
+		return hash_ == other.hash_;
+	}
+
+#ifdef STRING_VIEW_HAS_SPACESHIP_OPERATOR
+	inline constexpr auto operator<=>(const type_info& other) const noexcept
+	{
+		return hash_ <=> other.hash_;
+	}
+#endif
+
+	inline constexpr bool before(const type_info& other) const noexcept
+	{
+		return hash_ < other.hash_;
+	}
+
+private:
+	template <class T>
+	friend constexpr type_info get_type_info();
+
+	uint64_t hash_ = 0;
+};
+
+template <class T>
+constexpr type_info get_type_info()
+{
+	constexpr uint64_t hash = type_name_hash(type_name<T>());
+#ifndef NDEBUG
+	if (!std::is_constant_evaluated())
+	{
+		typename_impl::register_name<T>();
+	}
+#endif
+	type_info result;
+	result.hash_ = hash;
+	return result;
+}
+#else
 class type_info
 {
 public:
 	inline constexpr std::string_view name() const noexcept { return typename_; }
 
-	inline /*constexpr*/ size_t hash_code() const noexcept
+	inline constexpr size_t hash_code() const noexcept
 	{
-		return std::hash<std::string_view>{}(typename_);
+		return static_cast<size_t>(type_name_hash(typename_));
 	}
 
 	inline constexpr bool operator==(const type_info& other) const noexcept
@@ -82,6 +261,7 @@ constexpr type_info get_type_info()
 	result.typename_ = type_name<T>();
 	return result;
 }
+#endif
 
 }  // namespace really
 
@@ -95,7 +275,7 @@ struct std::hash<really::type_info>
 };
 
 // type-erased operations library
-namespace really::typeops
+REALLY_ANY_EXPORT namespace really::typeops
 {
 using unary_typeop_t = void (*)(void* ptr);
 using copy_typeop_t = void (*)(void* dest, const void* src);
@@ -186,7 +366,7 @@ inline move_typeop_t move_assign = typeop_impl::make_move_assign<T>();
 
 
 // any library
-namespace really
+REALLY_ANY_EXPORT namespace really
 {
 enum class any_copy_support
 {
@@ -195,8 +375,118 @@ enum class any_copy_support
 	copy_and_move,
 };
 
+// Called when a storage policy allocates on a thread inside a realtime_scope. It may log,
+// count or abort; if it returns, the allocation goes ahead.
+using realtime_allocation_handler = void (*)(size_t size);
+
 namespace detail
 {
+inline thread_local unsigned realtime_depth = 0;
+
+inline void default_realtime_allocation_handler(size_t)
+{
+	assert(false && "really::any storage allocated on a real-time thread");
+}
+
+// Not synchronized; install a handler before real-time threads start.
+inline realtime_allocation_handler realtime_handler = &default_realtime_allocation_handler;
+
+#if defined(REALLY_ANY_USDT)
+// The type of the value whose storage this thread is allocating or freeing, for the heap
+// probes. Set by any_base through REALLY_ANY_TRACE_STORAGE while those probes are attached.
+inline thread_local type_info traced_storage_type;
+
+class traced_storage_scope
+{
+public:
+	traced_storage_scope() = default;
+	traced_storage_scope(const traced_storage_scope&) = delete;
+	traced_storage_scope& operator=(const traced_storage_scope&) = delete;
+
+	~traced_storage_scope()
+	{
+		if (active_)
+		{
+			traced_storage_type = previous_;
+		}
+	}
+
+	void trace(type_info type)
+	{
+		previous_ = std::exchange(traced_storage_type, type);
+		active_ = true;
+	}
+
+private:
+	type_info previous_;
+	bool active_ = false;
+};
+
+#define REALLY_ANY_TRACE_STORAGE(type)                                                             \
+	detail::traced_storage_scope really_any_traced_storage;                                       \
+	if (REALLY_ANY_PROBE_ENABLED(heap_allocate) || REALLY_ANY_PROBE_ENABLED(heap_free))            \
+	{                                                                                              \
+		really_any_traced_storage.trace(type);                                                     \
+	}
+#else
+#define REALLY_ANY_TRACE_STORAGE(type) static_cast<void>(0)
+#endif
+
+// Every heap allocation made by a storage policy goes through here. The probes report the
+// pointer, the size, and the hash, name and name length of the value's type (empty outside
+// an any_base).
+inline void* heap_allocate(size_t size)
+{
+	if (realtime_depth != 0) [[unlikely]]
+	{
+		realtime_handler(size);
+	}
+	void* ptr = malloc(size);
+	REALLY_ANY_PROBE(heap_allocate, ptr, size, traced_storage_type.hash_code(),
+					 traced_storage_type.name().data(), traced_storage_type.name().size());
+	return ptr;
+}
+
+inline void heap_free(void* ptr)
+{
+	REALLY_ANY_PROBE(heap_free, ptr, traced_storage_type.hash_code(),
+					 traced_storage_type.name().data(), traced_storage_type.name().size());
+	::free(ptr);
+}
+} // namespace detail
+
+// Marks the current thread as real-time while it exists; scopes nest. Storage allocations made
+// inside one are reported to the realtime_allocation_handler, which by default asserts.
+class realtime_scope
+{
+public:
+	realtime_scope() { ++detail::realtime_depth; }
+	~realtime_scope() { --detail::realtime_depth; }
+
+	realtime_scope(const realtime_scope&) = delete;
+	realtime_scope& operator=(const realtime_scope&) = delete;
+};
+
+inline bool in_realtime_scope()
+{
+	return detail::realtime_depth != 0;
+}
+
+// Installs a new handler and returns the previous one.
+inline realtime_allocation_handler set_realtime_allocation_handler(
+	realtime_allocation_handler handler)
+{
+	return std::exchange(detail::realtime_handler, handler);
+}
+
+namespace detail
+{
+// The copy support two anys have in common.
+constexpr any_copy_support weaker(any_copy_support a, any_copy_support b)
+{
+	return a < b ? a : b;
+}
+
 template <class T>
 concept any_storage = requires(T storage, T* storage_ptr) {
 	storage.allocate(size_t());
@@ -217,11 +507,11 @@ concept any_storage = requires(T storage, T* storage_ptr) {
 
 struct any_heap_storage
 {
-	void allocate(size_t size) { data_ = malloc(size); }
+	void allocate(size_t size) { data_ = heap_allocate(size); }
 
 	void free()
 	{
-		::free(data_);
+		heap_free(data_);
 		data_ = nullptr;
 	}
 
@@ -241,7 +531,7 @@ private:
 template <size_t Size>
 struct any_local_storage
 {
-	void allocate(size_t size)
+	void allocate([[maybe_unused]] size_t size)
 	{
 		assert(size <= Size);
 		is_empty_ = false;
@@ -256,10 +546,38 @@ struct any_local_storage
 	bool try_swap(any_local_storage* other) { return false; }
 
 private:
-	char data_[Size];
+	alignas(std::max_align_t) char data_[Size];
 	bool is_empty_ = true;
 };
 
+// Whether a storage policy can hold a T at all. Inline-only storage rejects oversized values at
+// compile time instead of asserting at run time.
+template <class Storage, class T>
+constexpr bool storage_can_hold = true;
+
+template <size_t Size, class T>
+constexpr bool storage_can_hold<any_local_storage<Size>, T> =
+	sizeof(T) <= Size && alignof(T) <= alignof(std::max_align_t);
+
+// Bulk construction (see any_array.hpp) carves many heap payloads out of one allocation. Each
+// carved payload is preceded by this header, which says how to give it back.
+struct alignas(std::max_align_t) carved_payload_header
+{
+	void (*release)(void* owner);
+	void* owner;
+};
+
+class payload_carver
+{
+public:
+	// Returns room for a payload of the given size, following its header, or nullptr if there
+	// is none left.
+	virtual void* carve(size_t size) = 0;
+
+protected:
+	~payload_carver() = default;
+};
+
 template <size_t Size>
 struct any_small_buffer_storage
 {
@@ -274,7 +592,26 @@ struct any_small_buffer_storage
 		}
 		else
 		{
-			ptr_ = malloc(size);
+			ptr_ = heap_allocate(size);
+			state_ = state::heap;
+		}
+	}
+
+	// As allocate, but a payload too big for the buffer is carved if the carver has room.
+	void allocate(size_t size, payload_carver& carver)
+	{
+		assert(state_ == state::empty);
+		if (size <= sizeof(data_))
+		{
+			state_ = state::local;
+		}
+		else if ((ptr_ = carver.carve(size)) != nullptr)
+		{
+			state_ = state::carved;
+		}
+		else
+		{
+			ptr_ = heap_allocate(size);
 			state_ = state::heap;
 		}
 	}
@@ -283,7 +620,12 @@ struct any_small_buffer_storage
 	{
 		if (state_ == state::heap)
 		{
-			::free(ptr_);
+			heap_free(ptr_);
+		}
+		else if (state_ == state::carved)
+		{
+			const carved_payload_header* header = static_cast<carved_payload_header*>(ptr_) - 1;
+			header->release(header->owner);
 		}
 		state_ = state::empty;
 	}
@@ -296,6 +638,7 @@ struct any_small_buffer_storage
 		case state::empty:
 			return nullptr;
 		case state::heap:
+		case state::carved:
 			return ptr_;
 		case state::local:
 			return &data_[0];
@@ -310,9 +653,12 @@ struct any_small_buffer_storage
 	constexpr static bool can_always_swap = false;
 	bool try_swap(any_small_buffer_storage* other)
 	{
-		if (state_ == state::heap && other->state_ == state::heap)
+		// Heap, carved and empty buffers can trade places without touching the payload. Only a
+		// locally-stored value has to be moved through its type operations.
+		if (state_ != state::local && other->state_ != state::local)
 		{
 			std::swap(ptr_, other->ptr_);
+			std::swap(state_, other->state_);
 			return true;
 		}
 		return false;
@@ -324,6 +670,7 @@ private:
 		empty,
 		local,
 		heap,
+		carved,
 	};
 
 	union {
@@ -336,6 +683,165 @@ private:
 	};
 };
 
+// The largest value a storage policy holds without allocating from the heap.
+template <class Storage>
+constexpr size_t storage_inline_capacity = 0;
+
+template <size_t Size>
+constexpr size_t storage_inline_capacity<any_local_storage<Size>> = Size;
+
+template <size_t Size>
+constexpr size_t storage_inline_capacity<any_small_buffer_storage<Size>> =
+	Size < sizeof(void*) ? sizeof(void*) : Size;
+
+// One registered base class of a stored type: where the base subobject lives relative to the
+// start of the stored object.
+struct base_entry
+{
+	size_t hash;
+	type_info type;
+	ptrdiff_t offset;
+};
+
+// A stored type's registered bases, including indirect ones, sorted by hash.
+struct base_table
+{
+	const base_entry* entries = nullptr;
+	size_t count = 0;
+};
+} // namespace detail
+
+template <class... Bases>
+struct bases
+{
+};
+
+// Registers the base classes any_cast may convert a stored T to. Specialize it as
+//
+//	template <>
+//	struct really::base_classes<Derived> : really::bases<Base1, Base2> {};
+//
+// Bases registered for a base are found transitively. Virtual bases are not supported, since
+// their offset is not fixed.
+template <class T>
+struct base_classes : bases<>
+{
+};
+
+// Optional value-level operations for a stored type: hashing, comparison and binary
+// serialization. They are null unless the type opts in by specializing
+// value_operations_for (see really/reflect.hpp for aggregates).
+struct value_operations
+{
+	using write_fn = void (*)(void* context, const void* data, size_t size);
+
+	size_t (*hash)(const void* value);
+	bool (*equal)(const void* lhs, const void* rhs);
+	// Negative, zero or positive like a three-way comparison.
+	int (*compare)(const void* lhs, const void* rhs);
+	void (*serialize)(const void* value, write_fn write, void* context);
+	// Reads into an existing value, advancing in. Returns false on truncated input.
+	bool (*deserialize)(void* value, const unsigned char*& in, const unsigned char* end);
+};
+
+template <class T>
+struct value_operations_for
+{
+	static constexpr const value_operations* value = nullptr;
+};
+
+namespace detail
+{
+template <class T, class Base>
+ptrdiff_t base_offset()
+{
+	static_assert(std::is_base_of_v<Base, T>, "registered base is not a base class");
+	alignas(T) static unsigned char probe[sizeof(T)];
+	T* derived = reinterpret_cast<T*>(probe);
+	return reinterpret_cast<unsigned char*>(static_cast<Base*>(derived)) - probe;
+}
+
+template <class... Bases>
+constexpr size_t count_bases(bases<Bases...>*);
+
+// Upper bound on the number of direct and indirect registered bases of T.
+template <class T>
+constexpr size_t base_count = count_bases(static_cast<base_classes<T>*>(nullptr));
+
+template <class... Bases>
+constexpr size_t count_bases(bases<Bases...>*)
+{
+	return (size_t(0) + ... + (1 + base_count<Bases>));
+}
+
+template <class T>
+const base_table& get_base_table();
+
+template <class T, class... Bases>
+const base_table& make_base_table(bases<Bases...>*)
+{
+	if constexpr (sizeof...(Bases) == 0)
+	{
+		static const base_table empty;
+		return empty;
+	}
+	else
+	{
+		struct entries_t
+		{
+			base_entry data[base_count<T>];
+			size_t count = 0;
+
+			void add(const base_entry& entry)
+			{
+				for (size_t i = 0; i < count; ++i)
+				{
+					if (data[i].type == entry.type)
+					{
+						return;
+					}
+				}
+				data[count++] = entry;
+			}
+		};
+
+		static const entries_t entries = [] {
+			entries_t result;
+			(
+				[&] {
+					constexpr type_info base = really::get_type_info<Bases>();
+					ptrdiff_t offset = base_offset<T, Bases>();
+					result.add({base.hash_code(), base, offset});
+					const base_table& indirect = get_base_table<Bases>();
+					for (size_t i = 0; i < indirect.count; ++i)
+					{
+						base_entry entry = indirect.entries[i];
+						entry.offset += offset;
+						result.add(entry);
+					}
+				}(),
+				...);
+			// Insertion sort; tables are tiny and this keeps <algorithm> out of the header.
+			for (size_t i = 1; i < result.count; ++i)
+			{
+				for (size_t j = i; j > 0 && result.data[j].hash < result.data[j - 1].hash; --j)
+				{
+					std::swap(result.data[j], result.data[j - 1]);
+				}
+			}
+			return result;
+		}();
+		static const base_table table{entries.data, entries.count};
+		return table;
+	}
+}
+
+template <class T>
+const base_table& get_base_table()
+{
+	return make_base_table<T>(static_cast<base_classes<T>*>(nullptr));
+}
+
 class any_type_operations
 {
 public:
@@ -346,6 +852,23 @@ public:
 	virtual void move(void* dest, void* src) const = 0;
 	virtual void move_assign(void* dest, void* src) const = 0;
 	virtual void destruct(void* dest) const = 0;
+	// Which of copy and move construction, and of copy and move assignment, the type has.
+	// copy, move, copy_assign and move_assign do nothing for one it lacks.
+	virtual any_copy_support construct_support() const = 0;
+	virtual any_copy_support assign_support() const = 0;
+
+	virtual size_t alignment() const = 0;
+	// Default-constructs into dest. Returns false, constructing nothing, if the type is not
+	// default constructible.
+	virtual bool default_construct(void* dest) const = 0;
+	virtual base_table bases() const = 0;
+	virtual const value_operations* value_ops() const = 0;
+	// Batched forms operating on count contiguous objects, for containers that store many
+	// values of one runtime type side by side. move_n move-constructs into uninitialized dest;
+	// copy_assign_n assigns over constructed dest.
+	virtual void move_n(void* dest, void* src, size_t count) const = 0;
+	virtual void copy_assign_n(void* dest, const void* src, size_t count) const = 0;
+	virtual void destruct_n(void* dest, size_t count) const = 0;
 };
 
 template <class T>
@@ -387,10 +910,204 @@ class any_type_operations_impl : public any_type_operations
 	}
 
 	virtual void destruct(void* dest) const { typeops::destruct<T>(dest); }
+
+	virtual any_copy_support construct_support() const
+	{
+		return std::is_copy_constructible_v<T>   ? any_copy_support::copy_and_move
+			   : std::is_move_constructible_v<T> ? any_copy_support::move_only
+												 : any_copy_support::no_copy_or_move;
+	}
+
+	virtual any_copy_support assign_support() const
+	{
+		return std::is_copy_assignable_v<T>   ? any_copy_support::copy_and_move
+			   : std::is_move_assignable_v<T> ? any_copy_support::move_only
+											  : any_copy_support::no_copy_or_move;
+	}
+
+	virtual size_t alignment() const { return alignof(T); }
+	virtual base_table bases() const { return get_base_table<T>(); }
+	virtual const value_operations* value_ops() const { return value_operations_for<T>::value; }
+
+	virtual bool default_construct(void* dest) const
+	{
+		if (auto construct_func = typeops::default_construct<T>)
+		{
+			construct_func(dest);
+			return true;
+		}
+		return false;
+	}
+
+	virtual void move_n(void* dest, void* src, size_t count) const
+	{
+		if constexpr (std::is_trivially_copyable_v<T>)
+		{
+			std::memcpy(dest, src, count * sizeof(T));
+		}
+		else if (auto move_func = typeops::move_construct<T>)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				move_func(static_cast<T*>(dest) + i, static_cast<T*>(src) + i);
+			}
+		}
+	}
+
+	virtual void copy_assign_n(void* dest, const void* src, size_t count) const
+	{
+		if constexpr (std::is_trivially_copyable_v<T>)
+		{
+			std::memcpy(dest, src, count * sizeof(T));
+		}
+		else if (auto copy_func = typeops::copy_assign<T>)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				copy_func(static_cast<T*>(dest) + i, static_cast<const T*>(src) + i);
+			}
+		}
+	}
+
+	virtual void destruct_n(void* dest, size_t count) const
+	{
+		if constexpr (!std::is_trivially_destructible_v<T>)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				static_cast<T*>(dest)[i].~T();
+			}
+		}
+	}
+};
+
+// Types that can be copied, moved and destroyed bytewise share one operations class per size
+// and alignment, so storing thousands of such types adds one small constant object each
+// rather than a vtable and a set of functions. Only their identity is kept as data.
+template <size_t Size, size_t Align>
+class trivial_type_operations : public any_type_operations
+{
+public:
+	constexpr trivial_type_operations(type_info type, typeops::unary_typeop_t default_construct,
+									  const base_table& (*bases)(),
+									  const value_operations* value_ops)
+		: type_(type), default_construct_(default_construct), bases_(bases), value_ops_(value_ops)
+	{
+	}
+
+	virtual size_t size() const { return Size; }
+	virtual type_info get_type_info() const { return type_; }
+	virtual void copy(void* dest, const void* src) const { std::memcpy(dest, src, Size); }
+	virtual void copy_assign(void* dest, const void* src) const { std::memcpy(dest, src, Size); }
+	virtual void move(void* dest, void* src) const { std::memcpy(dest, src, Size); }
+	virtual void move_assign(void* dest, void* src) const { std::memcpy(dest, src, Size); }
+	virtual void destruct(void*) const {}
+	virtual any_copy_support construct_support() const { return any_copy_support::copy_and_move; }
+	virtual any_copy_support assign_support() const { return any_copy_support::copy_and_move; }
+
+	virtual size_t alignment() const { return Align; }
+	virtual base_table bases() const { return bases_(); }
+	virtual const value_operations* value_ops() const { return value_ops_; }
+
+	virtual bool default_construct(void* dest) const
+	{
+		if (default_construct_ == nullptr)
+		{
+			return false;
+		}
+		default_construct_(dest);
+		return true;
+	}
+
+	virtual void move_n(void* dest, void* src, size_t count) const
+	{
+		std::memcpy(dest, src, count * Size);
+	}
+
+	virtual void copy_assign_n(void* dest, const void* src, size_t count) const
+	{
+		std::memcpy(dest, src, count * Size);
+	}
+
+	virtual void destruct_n(void*, size_t) const {}
+
+private:
+	type_info type_;
+	typeops::unary_typeop_t default_construct_;
+	const base_table& (*bases_)();
+	const value_operations* value_ops_;
 };
 
+// Value-initializing a trivially default constructible type zero-fills it.
+template <size_t Size>
+void zero_construct(void* ptr)
+{
+	std::memset(ptr, 0, Size);
+}
+
+template <class T>
+constexpr bool shares_trivial_operations =
+#ifdef REALLY_ANY_NO_SHARED_TRIVIAL_OPS
+	false;
+#else
+	std::is_trivially_copy_constructible_v<T> && std::is_trivially_move_constructible_v<T> &&
+	std::is_trivially_copy_assignable_v<T> && std::is_trivially_move_assignable_v<T> &&
+	std::is_trivially_destructible_v<T>;
+#endif
+
 template <class T>
-constexpr inline any_type_operations_impl<T> type_operations = {};
+constexpr auto make_type_operations()
+{
+	if constexpr (shares_trivial_operations<T>)
+	{
+		typeops::unary_typeop_t construct = nullptr;
+		if constexpr (std::is_trivially_default_constructible_v<T>)
+		{
+			construct = &zero_construct<sizeof(T)>;
+		}
+		else
+		{
+			construct = typeops::typeop_impl::make_default_construct<T>();
+		}
+		return trivial_type_operations<sizeof(T), alignof(T)>(
+			really::get_type_info<T>(), construct, &get_base_table<T>,
+			value_operations_for<T>::value);
+	}
+	else
+	{
+		return any_type_operations_impl<T>();
+	}
+}
+
+template <class T>
+constexpr inline auto type_operations = make_type_operations<T>();
+
+// type_operations<T> for a value entering an any. Hash-only debug builds register names from
+// get_type_info() at runtime only, and the tables above are built at compile time, so the
+// type's name is registered here instead.
+template <class T>
+constexpr const auto& operations_for()
+{
+#if defined(REALLY_ANY_HASH_ONLY_TYPE_INFO) && !defined(NDEBUG)
+	if (!std::is_constant_evaluated())
+	{
+		typename_impl::register_name<T>();
+	}
+#endif
+	return type_operations<T>;
+}
+
+template <any_storage Storage, any_copy_support CopySupport>
+class any_base;
+
+consteval std::false_type is_any(...);
+
+template <any_storage Storage, any_copy_support CopySupport>
+consteval std::true_type is_any(any_base<Storage, CopySupport>*);
+
+// Anything but another any can be stored as a value; anys convert instead.
+template <class T>
+concept storable_value = !decltype(is_any(static_cast<std::remove_cvref_t<T>*>(nullptr)))::value;
 
 template <any_storage Storage, any_copy_support CopySupport>
 class any_base : Storage
@@ -398,6 +1115,8 @@ class any_base : Storage
 	using this_t = any_base<Storage, CopySupport>;
 public:
 	static constexpr any_copy_support copy_support = CopySupport;
+	// Values up to this size are held without a heap allocation.
+	static constexpr size_t inline_capacity = storage_inline_capacity<Storage>;
 
 	any_base() = default;
 	~any_base() { reset(); }
@@ -415,28 +1134,29 @@ public:
 	}
 
 	template <any_storage OtherStorage, any_copy_support OtherCopySupport>
-		requires(std::min(CopySupport, OtherCopySupport) == any_copy_support::copy_and_move)
+		requires(detail::weaker(CopySupport, OtherCopySupport) == any_copy_support::copy_and_move)
 	any_base(const any_base<OtherStorage, OtherCopySupport>& other)
 	{
 		copy(other);
 	}
 
 	template <any_storage OtherStorage, any_copy_support OtherCopySupport>
-		requires(std::min(CopySupport, OtherCopySupport) > any_copy_support::no_copy_or_move)
+		requires(detail::weaker(CopySupport, OtherCopySupport) > any_copy_support::no_copy_or_move)
 	any_base(any_base<OtherStorage, OtherCopySupport>&& other) noexcept
 	{
 		move(other);
 	}
 
 	template <class T>
-		requires(!std::is_base_of_v<this_t, T> && CopySupport == any_copy_support::copy_and_move && std::is_copy_constructible_v<T>)
+		requires(storable_value<T> && CopySupport == any_copy_support::copy_and_move && std::is_copy_constructible_v<T>)
 	any_base(const T& value)
 	{
 		emplace<T>(value);
 	}
 
 	template <class T>
-		requires(!std::is_base_of_v<this_t, T> && CopySupport > any_copy_support::no_copy_or_move && std::is_move_constructible_v<T>)
+		requires(storable_value<T> &&
+				 !std::is_lvalue_reference_v<T> && CopySupport > any_copy_support::no_copy_or_move && std::is_move_constructible_v<T>)
 	any_base(T&& value) noexcept
 	{
 		emplace<T>(std::move(value));
@@ -458,7 +1178,7 @@ public:
 	}
 
 	template <any_storage OtherStorage, any_copy_support OtherCopySupport>
-		requires(std::min(CopySupport, OtherCopySupport) == any_copy_support::copy_and_move)
+		requires(detail::weaker(CopySupport, OtherCopySupport) == any_copy_support::copy_and_move)
 	any_base& operator=(const any_base<OtherStorage, OtherCopySupport>& other)
 	{
 		copy(other);
@@ -466,7 +1186,7 @@ public:
 	}
 
 	template <any_storage OtherStorage, any_copy_support OtherCopySupport>
-		requires(std::min(CopySupport, OtherCopySupport) > any_copy_support::no_copy_or_move)
+		requires(detail::weaker(CopySupport, OtherCopySupport) > any_copy_support::no_copy_or_move)
 	any_base& operator=(any_base<OtherStorage, OtherCopySupport>&& other) noexcept
 	{
 		move(other);
@@ -474,7 +1194,7 @@ public:
 	}
 
 	template <class T>
-		requires(!std::is_base_of_v<this_t, T>&& CopySupport == any_copy_support::copy_and_move && std::is_copy_constructible_v<T>)
+		requires(storable_value<T> && CopySupport == any_copy_support::copy_and_move && std::is_copy_constructible_v<T>)
 	any_base& operator=(const T& value)
 	{
 		if (any_ops_ != nullptr && any_ops_->get_type_info() == get_type_info<T>())
@@ -490,7 +1210,7 @@ public:
 	}
 
 	template <class T>
-		requires(!std::is_base_of_v<this_t, T> && !std::is_lvalue_reference_v<T> &&
+		requires(storable_value<T> && !std::is_lvalue_reference_v<T> &&
 				 CopySupport > any_copy_support::no_copy_or_move && std::is_move_constructible_v<T>)
 	any_base& operator=(T&& value) noexcept
 	{
@@ -512,17 +1232,97 @@ public:
 		reset();
 
 		using value_t = std::decay_t<T>;
+		static_assert(storage_can_hold<Storage, value_t>, "value does not fit in this any");
+		REALLY_ANY_TRACE_STORAGE(really::get_type_info<value_t>());
 		this->allocate(sizeof(value_t));
 		void* storage = this->get_storage();
+		free_on_unwind guard{this};
+		new (storage) value_t(std::forward<Args>(args)...);
+		guard.self = nullptr;
+		any_ops_ = &operations_for<value_t>();
+		REALLY_ANY_PROBE_VALUE(emplace);
+		return *static_cast<value_t*>(storage);
+	}
+
+	// Like emplace, but a heap payload is carved by carver while it has room. For bulk
+	// construction; see any_array.hpp.
+	template <class T, class... Args>
+		requires requires(Storage& storage, payload_carver& carver) {
+			storage.allocate(size_t(), carver);
+		}
+	std::decay_t<T>& emplace_carved(payload_carver& carver, Args&&... args)
+	{
+		reset();
+
+		using value_t = std::decay_t<T>;
+		REALLY_ANY_TRACE_STORAGE(really::get_type_info<value_t>());
+		this->allocate(sizeof(value_t), carver);
+		void* storage = this->get_storage();
+		free_on_unwind guard{this};
 		new (storage) value_t(std::forward<Args>(args)...);
-		any_ops_ = &type_operations<value_t>;
+		guard.self = nullptr;
+		any_ops_ = &operations_for<value_t>();
+		REALLY_ANY_PROBE_VALUE(emplace);
 		return *static_cast<value_t*>(storage);
 	}
 
+	// Like emplace, but if the storage declines the allocation (as a budgeted storage over its
+	// limit does) returns nullptr and leaves the any empty.
+	template <class T, class... Args>
+	std::decay_t<T>* try_emplace(Args&&... args)
+	{
+		reset();
+
+		using value_t = std::decay_t<T>;
+		static_assert(storage_can_hold<Storage, value_t>, "value does not fit in this any");
+		REALLY_ANY_TRACE_STORAGE(really::get_type_info<value_t>());
+		if (!try_allocate_storage(sizeof(value_t)))
+		{
+			return nullptr;
+		}
+		void* storage = this->get_storage();
+		free_on_unwind guard{this};
+		new (storage) value_t(std::forward<Args>(args)...);
+		guard.self = nullptr;
+		any_ops_ = &operations_for<value_t>();
+		REALLY_ANY_PROBE_VALUE(emplace);
+		return static_cast<value_t*>(storage);
+	}
+
+	// Like copy assignment, but returns false, leaving the any empty, if the storage declines
+	// the allocation.
+	template <any_storage OtherStorage, any_copy_support OtherCopySupport>
+		requires(detail::weaker(CopySupport, OtherCopySupport) == any_copy_support::copy_and_move)
+	bool try_assign(const any_base<OtherStorage, OtherCopySupport>& other)
+	{
+		if (any_ops_ != nullptr && other.any_ops_ != nullptr &&
+			any_ops_->get_type_info() == other.any_ops_->get_type_info())
+		{
+			any_ops_->copy_assign(this->get_storage(), other.get_storage());
+			return true;
+		}
+
+		reset();
+		if (!other.has_value())
+		{
+			return true;
+		}
+		REALLY_ANY_TRACE_STORAGE(other.any_ops_->get_type_info());
+		if (!try_allocate_storage(other.any_ops_->size()))
+		{
+			return false;
+		}
+		other.any_ops_->copy(this->get_storage(), other.get_storage());
+		any_ops_ = other.any_ops_;
+		return true;
+	}
+
 	void swap(any_base& other)
 		requires(Storage::can_always_swap || CopySupport > any_copy_support::no_copy_or_move)
 	{
+		REALLY_ANY_PROBE_VALUE(swap);
 		auto move_into = [](any_base& dest, any_base& src) {
+			REALLY_ANY_TRACE_STORAGE(src.any_ops_->get_type_info());
 			dest.allocate(src.any_ops_->size());
 			src.any_ops_->move(dest.get_storage(), src.get_storage());
 			dest.any_ops_ = src.any_ops_;
@@ -532,6 +1332,7 @@ public:
 		// Try the easy pointer swap first.
 		if (this->try_swap(&other))
 		{
+			std::swap(any_ops_, other.any_ops_);
 			return;
 		}
 
@@ -570,13 +1371,21 @@ public:
 			return;
 		}
 		assert(any_ops_ != nullptr);
+		REALLY_ANY_PROBE_VALUE(reset);
 		any_ops_->destruct(storage);
+		REALLY_ANY_TRACE_STORAGE(any_ops_->get_type_info());
 		this->free();
 		any_ops_ = nullptr;
 	}
 
 	bool has_value() const { return this->get_storage() != nullptr; }
 
+	// The type of the held value, or void if empty.
+	type_info type() const
+	{
+		return any_ops_ != nullptr ? any_ops_->get_type_info() : really::get_type_info<void>();
+	}
+
 	template <class T>
 	bool has_type() const
 	{
@@ -602,7 +1411,70 @@ public:
 		return has_type<T>() ? static_cast<const std::decay_t<T>*>(this->get_storage()) : nullptr;
 	}
 
+	// Untyped access to the held value and its type operations, for type-erased containers.
+	void* data() { return this->get_storage(); }
+	const void* data() const { return this->get_storage(); }
+	const any_type_operations* operations() const { return any_ops_; }
+
+	// Replaces the held value with a copy of the object at src, whose type ops describes.
+	void copy_from(const any_type_operations& ops, const void* src)
+	{
+		reset();
+		REALLY_ANY_TRACE_STORAGE(ops.get_type_info());
+		this->allocate(ops.size());
+		free_on_unwind guard{this};
+		ops.copy(this->get_storage(), src);
+		guard.self = nullptr;
+		any_ops_ = &ops;
+		REALLY_ANY_PROBE_VALUE(copy);
+	}
+
+	void copy_from_carved(const any_type_operations& ops, const void* src, payload_carver& carver)
+		requires requires(Storage& storage) { storage.allocate(size_t(), carver); }
+	{
+		reset();
+		REALLY_ANY_TRACE_STORAGE(ops.get_type_info());
+		this->allocate(ops.size(), carver);
+		free_on_unwind guard{this};
+		ops.copy(this->get_storage(), src);
+		guard.self = nullptr;
+		any_ops_ = &ops;
+		REALLY_ANY_PROBE_VALUE(copy);
+	}
+
 private:
+	template <any_storage, any_copy_support>
+	friend class any_base;
+
+	// Gives the storage back if constructing a value into it throws, so the any is left empty
+	// rather than holding storage without type operations.
+	struct free_on_unwind
+	{
+		any_base* self;
+
+		~free_on_unwind()
+		{
+			if (self != nullptr)
+			{
+				self->free();
+			}
+		}
+	};
+
+	// Storage policies may offer a try_allocate that can refuse; the rest always succeed.
+	bool try_allocate_storage(size_t size)
+	{
+		if constexpr (requires(Storage& storage) { storage.try_allocate(size); })
+		{
+			return Storage::try_allocate(size);
+		}
+		else
+		{
+			this->allocate(size);
+			return true;
+		}
+	}
+
 	template <any_storage OtherStorage, any_copy_support OtherCopySupport>
 	void copy(const any_base<OtherStorage, OtherCopySupport>& other)
 	{
@@ -611,16 +1483,17 @@ private:
 			any_ops_->get_type_info() == other.any_ops_->get_type_info())
 		{
 			any_ops_->copy_assign(this->get_storage(), other.get_storage());
+			REALLY_ANY_PROBE_VALUE(copy);
 			return;
 		}
 
-		reset();
-
 		if (other.has_value())
 		{
-			this->allocate(other.any_ops_->size());
-			other.any_ops_->copy(this->get_storage(), other.get_storage());
-			any_ops_ = other.any_ops_;
+			copy_from(*other.any_ops_, other.get_storage());
+		}
+		else
+		{
+			reset();
 		}
 	}
 
@@ -632,6 +1505,7 @@ private:
 			any_ops_->get_type_info() == other.any_ops_->get_type_info())
 		{
 			any_ops_->move_assign(this->get_storage(), other.get_storage());
+			REALLY_ANY_PROBE_VALUE(move);
 			return;
 		}
 
@@ -639,21 +1513,30 @@ private:
 
 		if (other.has_value())
 		{
+			REALLY_ANY_TRACE_STORAGE(other.any_ops_->get_type_info());
 			this->allocate(other.any_ops_->size());
 			other.any_ops_->move(this->get_storage(), other.get_storage());
 			any_ops_ = other.any_ops_;
+			REALLY_ANY_PROBE_VALUE(move);
 			other.reset();
 		}
 	}
 
-	const any_type_operations* any_ops_ = nullptr;
-};
-
-consteval std::false_type is_any(...);
+	type_info trace_type() const
+	{
+		return any_ops_ != nullptr ? any_ops_->get_type_info() : type_info();
+	}
 
-template <any_storage Storage, any_copy_support CopySupport>
-consteval std::true_type is_any(any_base<Storage, CopySupport>*);
+	// Whether the value lives outside the any itself.
+	bool trace_on_heap() const
+	{
+		auto* storage = static_cast<const std::byte*>(this->get_storage());
+		auto* self = reinterpret_cast<const std::byte*>(this);
+		return storage != nullptr && (storage < self || storage >= self + sizeof(*this));
+	}
 
+	const any_type_operations* any_ops_ = nullptr;
+};
 } // namespace detail
 
 template <any_copy_support CopySupport = any_copy_support::copy_and_move>
@@ -672,11 +1555,17 @@ public:
 	heap_any& operator=(heap_any&&) noexcept = default;
 };
 
+// An any whose values are always stored inline in Size bytes. Values that do not fit, and
+// other anys, are rejected at compile time, so it never touches the heap.
 template <size_t Size, any_copy_support CopySupport = any_copy_support::copy_and_move>
 class any_of_size : public detail::any_base<detail::any_local_storage<Size>, CopySupport>
 {
 	using base_t = detail::any_base<detail::any_local_storage<Size>, CopySupport>;
 
+	template <class T>
+	static constexpr bool storable =
+		detail::storage_can_hold<detail::any_local_storage<Size>, T> && detail::storable_value<T>;
+
 public:
 	any_of_size() = default;
 	any_of_size(const any_of_size&) = default;
@@ -684,25 +1573,42 @@ public:
 	any_of_size(any_of_size&&) noexcept = default;
 	any_of_size& operator=(any_of_size&&) noexcept = default;
 
+	// Converting from a smaller any_of_size can't overflow, so it is allowed.
+	template <size_t OtherSize, any_copy_support OtherCopySupport>
+		requires(OtherSize < Size && detail::weaker(CopySupport, OtherCopySupport) ==
+										 any_copy_support::copy_and_move)
+	any_of_size(const any_of_size<OtherSize, OtherCopySupport>& other) : base_t(other)
+	{
+	}
+
+	template <size_t OtherSize, any_copy_support OtherCopySupport>
+		requires(OtherSize < Size && detail::weaker(CopySupport, OtherCopySupport) >
+										 any_copy_support::no_copy_or_move)
+	any_of_size(any_of_size<OtherSize, OtherCopySupport>&& other) noexcept
+		: base_t(std::move(other))
+	{
+	}
+
 	template <class T>
 		requires(CopySupport == any_copy_support::copy_and_move &&
-				 std::is_copy_constructible_v<T> && sizeof(T) <= Size)
+				 std::is_copy_constructible_v<T> && storable<T>)
 	explicit any_of_size(const T& value)
 	{
-		emplace<T>(value);
+		this->template emplace<T>(value);
 	}
 
 	template <class T>
-		requires(CopySupport > any_copy_support::no_copy_or_move &&
-				 std::is_move_constructible_v<T> && sizeof(T) <= Size)
+		requires(!std::is_lvalue_reference_v<T> &&
+				 CopySupport > any_copy_support::no_copy_or_move &&
+				 std::is_move_constructible_v<T> && storable<T>)
 	explicit any_of_size(T&& value)
 	{
-		emplace<T>(std::move(value));
+		this->template emplace<T>(std::move(value));
 	}
 
 	template <class T>
 		requires(CopySupport == any_copy_support::copy_and_move && std::is_copy_assignable_v<T> &&
-				 sizeof(T) <= Size)
+				 storable<T>)
 	any_of_size& operator=(const T& value)
 	{
 		base_t::operator=(value);
@@ -712,7 +1618,7 @@ public:
 	template <class T>
 		requires(!std::is_lvalue_reference_v<T> &&
 				 CopySupport > any_copy_support::no_copy_or_move && std::is_move_assignable_v<T> &&
-				 sizeof(T) <= Size)
+				 storable<T>)
 	any_of_size& operator=(T&& value) noexcept
 	{
 		base_t::operator=(std::move(value));
@@ -720,6 +1626,11 @@ public:
 	}
 };
 
+// The configuration for real-time threads: an any with the inline capacity of any<> that
+// rejects, at compile time, every value that would need the heap.
+template <any_copy_support CopySupport = any_copy_support::copy_and_move>
+using realtime_any = any_of_size<2 * sizeof(void*) - 1, CopySupport>;
+
 template <any_copy_support CopySupport = any_copy_support::copy_and_move>
 class any
 	: public detail::any_base<detail::any_small_buffer_storage<2 * sizeof(void*) - 1>, CopySupport>
@@ -740,16 +1651,82 @@ public:
 
 static_assert(sizeof(any<>) == (3 * sizeof(void*)), "Internal error: any is not expected size");
 
+using detail::any_type_operations;
+
+// The type operations table for T, as used by every any holding a T.
+template <class T>
+constexpr const any_type_operations& get_type_operations()
+{
+	return detail::operations_for<std::decay_t<T>>();
+}
+
 template <class T>
 concept any_any = std::is_same_v<std::true_type, decltype(detail::is_any(std::declval<T*>()))>;
 
 static_assert(any_any<any<>>);
 
+namespace detail
+{
+// Finds a registered base by hash and type, and applies its offset.
+template <class Base>
+const void* cast_to_base(const any_type_operations* ops, const void* value)
+{
+	constexpr type_info target = really::get_type_info<Base>();
+	constexpr size_t hash = target.hash_code();
+	if (ops == nullptr)
+	{
+		return nullptr;
+	}
+
+	base_table table = ops->bases();
+	const base_entry* end = table.entries + table.count;
+	const base_entry* it = table.entries;
+	for (size_t count = table.count; count > 0;)
+	{
+		size_t half = count / 2;
+		if (it[half].hash < hash)
+		{
+			it += half + 1;
+			count -= half + 1;
+		}
+		else
+		{
+			count = half;
+		}
+	}
+	for (; it != end && it->hash == hash; ++it)
+	{
+		if (it->type == target)
+		{
+			return static_cast<const char*>(value) + it->offset;
+		}
+	}
+	return nullptr;
+}
+} // namespace detail
+
+// Returns the held value as a T if it is exactly a T, or if T is one of the held type's
+// registered base_classes.
 template <class T, any_any Any>
-T* any_cast(Any* any) { return any->template try_get_value<T>(); }
+T* any_cast(Any* any)
+{
+	if (T* exact = any->template try_get_value<T>())
+	{
+		return exact;
+	}
+	return const_cast<T*>(
+		static_cast<const T*>(detail::cast_to_base<T>(any->operations(), any->data())));
+}
 
 template <class T, any_any Any>
-const T* any_cast(const Any* any) { return any->template try_get_value<T>(); }
+const T* any_cast(const Any* any)
+{
+	if (const T* exact = any->template try_get_value<T>())
+	{
+		return exact;
+	}
+	return static_cast<const T*>(detail::cast_to_base<T>(any->operations(), any->data()));
+}
 
 using copyable_any = any<any_copy_support::copy_and_move>;
 using movable_any = any<any_copy_support::move_only>;
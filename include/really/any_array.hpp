@@ -0,0 +1,202 @@
+#pragma once
+
+#include "really/any.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <ranges>
+#include <vector>
+
+
+namespace really
+{
+namespace detail
+{
+// One heap block holding the payloads of many anys built together, laid out back to back in
+// construction order. Each payload can be released on its own; the block is freed with the
+// last one.
+class payload_slab final : public payload_carver
+{
+public:
+	// The bytes carve(size) takes from the block.
+	static constexpr size_t footprint(size_t size)
+	{
+		constexpr size_t align = alignof(std::max_align_t);
+		return sizeof(carved_payload_header) + (size + align - 1) / align * align;
+	}
+
+	// Creates a slab with room for payloads whose footprints sum to bytes. The caller holds one
+	// reference, dropped with release().
+	static payload_slab* create(size_t bytes)
+	{
+		void* block = heap_allocate(sizeof(payload_slab) + bytes);
+		return ::new (block) payload_slab(bytes);
+	}
+
+	virtual void* carve(size_t size)
+	{
+		size_t bytes = footprint(size);
+		if (static_cast<size_t>(end_ - next_) < bytes)
+		{
+			return nullptr;
+		}
+		auto* header = ::new (next_) carved_payload_header{&release_payload, this};
+		next_ += bytes;
+		live_.fetch_add(1, std::memory_order_relaxed);
+		return header + 1;
+	}
+
+	void release() { release_payload(this); }
+
+private:
+	explicit payload_slab(size_t bytes)
+		: next_(reinterpret_cast<std::byte*>(this + 1)), end_(next_ + bytes)
+	{
+	}
+
+	static void release_payload(void* owner)
+	{
+		auto* slab = static_cast<payload_slab*>(owner);
+		if (slab->live_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			slab->~payload_slab();
+			heap_free(slab);
+		}
+	}
+
+	// Payloads not yet released, plus one for the builder until it calls release().
+	alignas(std::max_align_t) std::atomic<size_t> live_{1};
+	std::byte* next_;
+	std::byte* end_;
+};
+
+static_assert(sizeof(payload_slab) % alignof(std::max_align_t) == 0);
+
+struct slab_release
+{
+	void operator()(payload_slab* slab) const { slab->release(); }
+};
+
+// The builder's reference to a slab, dropped however building ends.
+using slab_reference = std::unique_ptr<payload_slab, slab_release>;
+
+inline slab_reference make_slab(size_t bytes)
+{
+	return slab_reference(bytes != 0 ? payload_slab::create(bytes) : nullptr);
+}
+
+// Whether Any's storage can take its heap payload from a carver. Others allocate as usual.
+template <class Any>
+concept carving_any = requires(Any& value, payload_carver& carver) {
+	value.template emplace_carved<int>(carver, 0);
+};
+
+// The slab bytes an any would need to hold a value of the given size.
+template <any_any Any>
+constexpr size_t slab_bytes_for(size_t size)
+{
+	if constexpr (carving_any<Any>)
+	{
+		return size > Any::inline_capacity ? payload_slab::footprint(size) : 0;
+	}
+	else
+	{
+		return 0;
+	}
+}
+} // namespace detail
+
+// Appends count anys, each holding a T constructed from args. Values too big for the inline
+// buffer share one heap block instead of taking an allocation each.
+template <class T, any_any Any, class... Args>
+void emplace_n(std::vector<Any>& out, size_t count, const Args&... args)
+{
+	using value_t = std::decay_t<T>;
+	size_t bytes = count * detail::slab_bytes_for<Any>(sizeof(value_t));
+	detail::slab_reference slab = detail::make_slab(bytes);
+
+	out.reserve(out.size() + count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		Any& value = out.emplace_back();
+		if constexpr (detail::carving_any<Any>)
+		{
+			if (slab != nullptr)
+			{
+				value.template emplace_carved<value_t>(*slab, args...);
+				continue;
+			}
+		}
+		value.template emplace<value_t>(args...);
+	}
+}
+
+// Builds an array of anys from a range, carving every heap payload out of one block. The
+// range's elements may be plain values, or anys whose held values are copied. Each element
+// stays independently resettable; the block is freed once the last payload it holds is.
+template <any_any Any = any<>, std::ranges::forward_range R>
+std::vector<Any> make_any_array(R&& range)
+{
+	using element_t = std::ranges::range_value_t<R>;
+	constexpr bool from_anys = any_any<element_t>;
+
+	// Size the block up front.
+	size_t count = 0;
+	size_t bytes = 0;
+	for (const auto& element : range)
+	{
+		++count;
+		if constexpr (from_anys)
+		{
+			if (const any_type_operations* ops = element.operations())
+			{
+				bytes += detail::slab_bytes_for<Any>(ops->size());
+			}
+		}
+		else
+		{
+			bytes += detail::slab_bytes_for<Any>(sizeof(element_t));
+		}
+	}
+
+	detail::slab_reference slab = detail::make_slab(bytes);
+	std::vector<Any> result;
+	result.reserve(count);
+	for (const auto& element : range)
+	{
+		Any& value = result.emplace_back();
+		if constexpr (from_anys)
+		{
+			if (!element.has_value())
+			{
+				continue;
+			}
+			if constexpr (detail::carving_any<Any>)
+			{
+				if (slab != nullptr)
+				{
+					value.copy_from_carved(*element.operations(), element.data(), *slab);
+					continue;
+				}
+			}
+			value.copy_from(*element.operations(), element.data());
+		}
+		else
+		{
+			if constexpr (detail::carving_any<Any>)
+			{
+				if (slab != nullptr)
+				{
+					value.template emplace_carved<element_t>(*slab, element);
+					continue;
+				}
+			}
+			value.template emplace<element_t>(element);
+		}
+	}
+	return result;
+}
+} // namespace really
@@ -0,0 +1,281 @@
+#pragma once
+
+#include "really/any.hpp"
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace really
+{
+// The producer side of an any_range, implemented once per kind of sequence.
+//
+// Elements are handed over in batches into a buffer the consumer owns, so iterating across a
+// module or plugin boundary costs one indirect call per batch rather than one per element.
+class any_range_source
+{
+public:
+	virtual ~any_range_source() = default;
+
+	// The operations of the element type, which also identify it.
+	virtual const any_type_operations& element_operations() const = 0;
+
+	// Assigns up to count of the next elements into dest, an array of constructed objects of
+	// the element type. Returns how many were written; 0 means the range is exhausted.
+	virtual size_t pull(void* dest, size_t count) = 0;
+
+	// As above, but stores each element as the value of an any.
+	virtual size_t pull(std::span<any<>> dest) = 0;
+};
+
+// A type-erased, single-pass input range.
+//
+// Consumers that know the element type pull it straight into a typed buffer; those that don't
+// get anys. Range-for over an any_range buffers a batch of anys internally.
+class any_range
+{
+public:
+	static constexpr size_t default_batch_size = 64;
+
+	any_range() = default;
+	explicit any_range(std::unique_ptr<any_range_source> source) : source_(std::move(source)) {}
+
+	any_range(any_range&&) noexcept = default;
+	any_range& operator=(any_range&&) noexcept = default;
+
+	bool has_source() const { return source_ != nullptr; }
+
+	// The element type, or void if there is no source.
+	type_info element_type() const
+	{
+		return source_ != nullptr ? source_->element_operations().get_type_info()
+								  : really::get_type_info<void>();
+	}
+
+	template <class T>
+	bool has_element_type() const
+	{
+		return element_type() == really::get_type_info<T>();
+	}
+
+	// Typed pull; the element type must be T.
+	template <class T>
+	size_t pull(std::span<T> buffer)
+	{
+		assert(has_element_type<T>());
+		return source_->pull(buffer.data(), buffer.size());
+	}
+
+	size_t pull(std::span<any<>> buffer)
+	{
+		return source_ != nullptr ? source_->pull(buffer) : 0;
+	}
+
+	// Calls f(T&) for each remaining element holding a T. Batches are pulled into a T array when
+	// T is the element type, and into anys otherwise, in which case other types are skipped.
+	template <class T, size_t BatchSize = default_batch_size, class F>
+	void for_each(F&& f)
+	{
+		if constexpr (std::is_default_constructible_v<T> && std::is_copy_assignable_v<T>)
+		{
+			if (source_ != nullptr && has_element_type<T>())
+			{
+				std::array<T, BatchSize> batch;
+				while (size_t count = source_->pull(batch.data(), BatchSize))
+				{
+					for (size_t i = 0; i < count; ++i)
+					{
+						f(batch[i]);
+					}
+				}
+				return;
+			}
+		}
+
+		std::array<any<>, BatchSize> batch;
+		while (size_t count = pull(batch))
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				if (T* value = batch[i].template try_get_value<T>())
+				{
+					f(*value);
+				}
+			}
+		}
+	}
+
+	class iterator
+	{
+	public:
+		using value_type = any<>;
+		using difference_type = ptrdiff_t;
+
+		iterator() = default;
+
+		any<>& operator*() const { return *current_; }
+		any<>* operator->() const { return current_; }
+
+		iterator& operator++()
+		{
+			if (++current_ == last_)
+			{
+				*this = range_->refill();
+			}
+			return *this;
+		}
+
+		void operator++(int) { ++*this; }
+
+		friend bool operator==(const iterator& it, std::default_sentinel_t)
+		{
+			return it.current_ == nullptr;
+		}
+
+	private:
+		friend class any_range;
+
+		iterator(any_range* range, any<>* current, any<>* last)
+			: range_(range), current_(current), last_(last)
+		{
+		}
+
+		any_range* range_ = nullptr;
+		any<>* current_ = nullptr;
+		any<>* last_ = nullptr;
+	};
+
+	// Starts iteration. As with any input range, begin is called once.
+	iterator begin() { return refill(); }
+
+	std::default_sentinel_t end() const { return {}; }
+
+private:
+	// Pulls the next batch of anys, returning an iterator to its start or the end.
+	iterator refill()
+	{
+		buffer_.resize(default_batch_size);
+		size_t count = pull(buffer_);
+		if (count == 0)
+		{
+			return {};
+		}
+		return iterator(this, buffer_.data(), buffer_.data() + count);
+	}
+
+	std::unique_ptr<any_range_source> source_;
+	std::vector<any<>> buffer_;
+};
+
+static_assert(std::ranges::input_range<any_range>);
+
+namespace detail
+{
+template <std::ranges::input_range R>
+class range_source final : public any_range_source
+{
+	using value_t = std::ranges::range_value_t<R>;
+
+public:
+	explicit range_source(R&& range)
+		: range_(std::views::all(std::forward<R>(range))), next_(std::ranges::begin(range_))
+	{
+	}
+
+	virtual const any_type_operations& element_operations() const
+	{
+		return get_type_operations<value_t>();
+	}
+
+	virtual size_t pull(void* dest, size_t count)
+	{
+		auto* out = static_cast<value_t*>(dest);
+		size_t n = 0;
+		for (; n < count && next_ != std::ranges::end(range_); ++n, ++next_)
+		{
+			out[n] = *next_;
+		}
+		return n;
+	}
+
+	virtual size_t pull(std::span<any<>> dest)
+	{
+		size_t n = 0;
+		for (; n < dest.size() && next_ != std::ranges::end(range_); ++n, ++next_)
+		{
+			dest[n] = *next_;
+		}
+		return n;
+	}
+
+private:
+	std::views::all_t<R> range_;
+	std::ranges::iterator_t<std::views::all_t<R>> next_;
+};
+
+// Objects of one runtime type laid out contiguously, such as an archetype column.
+class array_source final : public any_range_source
+{
+public:
+	array_source(const any_type_operations& ops, const void* data, size_t count)
+		: ops_(ops), next_(static_cast<const std::byte*>(data)), remaining_(count)
+	{
+	}
+
+	virtual const any_type_operations& element_operations() const { return ops_; }
+
+	virtual size_t pull(void* dest, size_t count)
+	{
+		size_t n = take(count);
+		ops_.copy_assign_n(dest, next_, n);
+		next_ += n * ops_.size();
+		return n;
+	}
+
+	virtual size_t pull(std::span<any<>> dest)
+	{
+		size_t n = take(dest.size());
+		for (size_t i = 0; i < n; ++i, next_ += ops_.size())
+		{
+			dest[i].copy_from(ops_, next_);
+		}
+		return n;
+	}
+
+private:
+	size_t take(size_t count)
+	{
+		size_t n = count < remaining_ ? count : remaining_;
+		remaining_ -= n;
+		return n;
+	}
+
+	const any_type_operations& ops_;
+	const std::byte* next_;
+	size_t remaining_;
+};
+} // namespace detail
+
+// Adapts a C++ range. Lvalue ranges are referenced and must outlive the any_range; rvalue
+// ranges are moved into it. A range of anys (such as a slot_map's values()) yields their
+// held values when pulled into anys.
+template <std::ranges::input_range R>
+any_range make_any_range(R&& range)
+{
+	return any_range(std::make_unique<detail::range_source<R>>(std::forward<R>(range)));
+}
+
+// Adapts count contiguous objects of the type ops describes, such as an archetype column.
+inline any_range make_any_range(const any_type_operations& ops, const void* data, size_t count)
+{
+	return any_range(std::make_unique<detail::array_source>(ops, data, count));
+}
+} // namespace really
@@ -0,0 +1,575 @@
+#pragma once
+
+#include "really/any.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+
+namespace really
+{
+struct entity
+{
+	uint32_t index = UINT32_MAX;
+	uint32_t generation = 0;
+
+	constexpr bool operator==(const entity&) const = default;
+};
+
+// A table of all entities sharing one set of component types. Each component type is stored
+// in its own contiguous column, and row i of every column belongs to entities()[i].
+//
+// Columns are keyed by really::type_info rather than by ops table address, so components
+// registered from different modules still land in the same archetype.
+class archetype
+{
+public:
+	archetype(std::vector<const any_type_operations*> ops)
+	{
+		std::sort(ops.begin(), ops.end(), [](auto* a, auto* b) {
+			return a->get_type_info().before(b->get_type_info());
+		});
+		columns_.reserve(ops.size());
+		types_.reserve(ops.size());
+		for (const any_type_operations* o : ops)
+		{
+			columns_.push_back({o});
+			types_.push_back(o->get_type_info());
+		}
+	}
+
+	~archetype()
+	{
+		for (column_t& c : columns_)
+		{
+			c.ops->destruct_n(c.data, size_);
+			::operator delete(c.data, static_cast<std::align_val_t>(c.ops->alignment()));
+		}
+	}
+
+	archetype(const archetype&) = delete;
+	archetype& operator=(const archetype&) = delete;
+
+	// Component types, sorted by type_info::before.
+	std::span<const type_info> types() const { return types_; }
+	std::span<const entity> entities() const { return entities_; }
+	size_t size() const { return size_; }
+
+	bool contains(type_info type) const { return find(type) != nullptr; }
+
+	void* column(type_info type)
+	{
+		const column_t* c = find(type);
+		return c != nullptr ? c->data : nullptr;
+	}
+
+	template <class T>
+	T* column()
+	{
+		return static_cast<T*>(column(really::get_type_info<T>()));
+	}
+
+	// The operations of a column's component type, for walking the column without knowing it.
+	const any_type_operations* operations(type_info type) const
+	{
+		const column_t* c = find(type);
+		return c != nullptr ? c->ops : nullptr;
+	}
+
+private:
+	friend class archetype_store;
+
+	struct column_t
+	{
+		const any_type_operations* ops;
+		void* data = nullptr;
+	};
+
+	const column_t* find(type_info type) const
+	{
+		auto it = std::lower_bound(types_.begin(), types_.end(), type,
+								   [](const type_info& a, const type_info& b) {
+									   return a.before(b);
+								   });
+		return it != types_.end() && *it == type ? &columns_[it - types_.begin()] : nullptr;
+	}
+
+	void* at(const column_t& c, size_t row) const
+	{
+		return static_cast<std::byte*>(c.data) + row * c.ops->size();
+	}
+
+	// Adds uninitialized rows for the given entities and returns the first new row. The caller
+	// constructs every component of the new rows.
+	size_t push_rows(std::span<const entity> added)
+	{
+		size_t needed = size_ + added.size();
+		if (needed > capacity_)
+		{
+			grow(std::max(needed, capacity_ * 2));
+		}
+		entities_.insert(entities_.end(), added.begin(), added.end());
+		size_t first = size_;
+		size_ = needed;
+		return first;
+	}
+
+	// Drops the last count rows, none of whose components are constructed.
+	void pop_rows(size_t count)
+	{
+		entities_.resize(entities_.size() - count);
+		size_ -= count;
+	}
+
+	// Removes a row by moving the last row into it. Returns the entity that moved, if any.
+	entity swap_remove(size_t row)
+	{
+		size_t last = size_ - 1;
+		for (column_t& c : columns_)
+		{
+			c.ops->destruct(at(c, row));
+			if (row != last)
+			{
+				c.ops->move(at(c, row), at(c, last));
+				c.ops->destruct(at(c, last));
+			}
+		}
+
+		entity moved;
+		if (row != last)
+		{
+			entities_[row] = entities_[last];
+			moved = entities_[row];
+		}
+		entities_.pop_back();
+		--size_;
+		return moved;
+	}
+
+	// Relocates every column to a larger block with one batched move and destroy per column.
+	void grow(size_t capacity)
+	{
+		for (column_t& c : columns_)
+		{
+			auto align = static_cast<std::align_val_t>(c.ops->alignment());
+			void* data = ::operator new(capacity * c.ops->size(), align);
+			if (c.data != nullptr)
+			{
+				c.ops->move_n(data, c.data, size_);
+				c.ops->destruct_n(c.data, size_);
+				::operator delete(c.data, align);
+			}
+			c.data = data;
+		}
+		entities_.reserve(capacity);
+		capacity_ = capacity;
+	}
+
+	std::vector<column_t> columns_;
+	std::vector<type_info> types_;
+	std::vector<entity> entities_;
+	size_t size_ = 0;
+	size_t capacity_ = 0;
+
+	// Cached archetype transitions when adding or removing one component type.
+	std::unordered_map<type_info, archetype*> add_edges_;
+	std::unordered_map<type_info, archetype*> remove_edges_;
+};
+
+// Entity-component storage grouping entities by their exact set of component types.
+//
+// Adding or removing a component moves an entity's row to another archetype. Queries visit
+// each archetype containing the requested types and iterate its columns linearly.
+class archetype_store
+{
+public:
+	archetype_store() { empty_ = get_archetype({}); }
+
+	entity create()
+	{
+		entity e = allocate_entity();
+		place(e, *empty_, empty_->push_rows({&e, 1}));
+		return e;
+	}
+
+	// Creates count entities with copies of the given components. All rows are added to the
+	// destination archetype at once, one column at a time. If a copy throws, the rows are
+	// dropped and no entity is created.
+	template <class... T>
+	std::vector<entity> create_n(size_t count, const T&... components)
+	{
+		archetype& arch = *get_archetype({&get_type_operations<T>()...});
+		std::vector<entity> created(count);
+		records_.reserve(records_.size() + count);
+
+		const std::array<const any_type_operations*, sizeof...(T)> ops{
+			&get_type_operations<T>()...};
+		size_t first = arch.push_rows(created);
+		drop_rows_on_unwind guard{&arch, ops, first, count};
+		auto fill = [&]<class C>(C* column, const C& component) {
+			for (guard.rows = 0; guard.rows < count; ++guard.rows)
+			{
+				::new (column + first + guard.rows) C(component);
+			}
+			++guard.columns;
+		};
+		(fill(arch.column<T>(), components), ...);
+		guard.arch = nullptr;
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			created[i] = allocate_entity();
+			arch.entities_[first + i] = created[i];
+			place(created[i], arch, first + i);
+		}
+		return created;
+	}
+
+	bool alive(entity e) const
+	{
+		return e.index < records_.size() && records_[e.index].generation == e.generation;
+	}
+
+	bool destroy(entity e)
+	{
+		if (!alive(e))
+		{
+			return false;
+		}
+
+		record& r = records_[e.index];
+		remove_row(*r.arch, r.row);
+		++r.generation;
+		r.arch = nullptr;
+		r.row = free_head_;
+		free_head_ = e.index;
+		return true;
+	}
+
+	// Adds (or replaces) a component constructed from args. If the constructor throws, e keeps
+	// its components as they were.
+	template <class T, class... Args>
+	T* add(entity e, Args&&... args)
+	{
+		auto construct = [&](void* dest) { ::new (dest) T(std::forward<Args>(args)...); };
+		auto replace = [&](void* existing) {
+			if constexpr (std::is_move_assignable_v<T>)
+			{
+				*static_cast<T*>(existing) = T(std::forward<Args>(args)...);
+			}
+			else
+			{
+				T replacement(std::forward<Args>(args)...);
+				static_cast<T*>(existing)->~T();
+				::new (existing) T(std::move(replacement));
+			}
+		};
+		return static_cast<T*>(add_component(e, get_type_operations<T>(), construct, replace));
+	}
+
+	// Adds (or replaces) a component whose type is only known at runtime, moving it out of an
+	// any. This is how plugin-defined components enter the store.
+	template <any_any Any>
+	void* add(entity e, Any&& value)
+	{
+		const any_type_operations* ops = value.operations();
+		if (ops == nullptr || ops->construct_support() == any_copy_support::no_copy_or_move)
+		{
+			return nullptr;
+		}
+		auto construct = [&](void* dest) { ops->move(dest, value.data()); };
+		auto replace = [&](void* existing) {
+			if (ops->assign_support() != any_copy_support::no_copy_or_move)
+			{
+				ops->move_assign(existing, value.data());
+			}
+			else
+			{
+				ops->destruct(existing);
+				ops->move(existing, value.data());
+			}
+		};
+		void* slot = add_component(e, *ops, construct, replace);
+		if (slot != nullptr)
+		{
+			value.reset();
+		}
+		return slot;
+	}
+
+	template <class T>
+	bool remove(entity e)
+	{
+		return remove(e, really::get_type_info<T>());
+	}
+
+	bool remove(entity e, type_info type)
+	{
+		if (!alive(e) || !records_[e.index].arch->contains(type))
+		{
+			return false;
+		}
+
+		record& r = records_[e.index];
+		archetype& from = *r.arch;
+		archetype*& to = from.remove_edges_[type];
+		if (to == nullptr)
+		{
+			std::vector<const any_type_operations*> ops;
+			for (const archetype::column_t& c : from.columns_)
+			{
+				if (c.ops->get_type_info() != type)
+				{
+					ops.push_back(c.ops);
+				}
+			}
+			to = get_archetype(std::move(ops));
+		}
+
+		archetype* dest = to;
+		size_t row = dest->push_rows({&e, 1});
+		for (archetype::column_t& c : from.columns_)
+		{
+			void* src = from.at(c, r.row);
+			if (void* d = dest->column(c.ops->get_type_info()))
+			{
+				c.ops->move(static_cast<std::byte*>(d) + row * c.ops->size(), src);
+			}
+		}
+		remove_row(from, r.row);
+		place(e, *dest, row);
+		return true;
+	}
+
+	void* get(entity e, type_info type)
+	{
+		if (!alive(e))
+		{
+			return nullptr;
+		}
+		record& r = records_[e.index];
+		const archetype::column_t* column = r.arch->find(type);
+		return column != nullptr ? r.arch->at(*column, r.row) : nullptr;
+	}
+
+	template <class T>
+	T* get(entity e)
+	{
+		return static_cast<T*>(get(e, really::get_type_info<T>()));
+	}
+
+	// Calls f(T&...) or f(entity, T&...) for every entity having all of the given components.
+	template <class... T, class F>
+	void each(F&& f)
+	{
+		const type_info types[] = {really::get_type_info<T>()...};
+		for_each_archetype(types, [&](archetype& arch) {
+			std::tuple<T*...> columns{arch.column<T>()...};
+			std::span<const entity> entities = arch.entities();
+			for (size_t row = 0; row < arch.size(); ++row)
+			{
+				if constexpr (std::is_invocable_v<F&, entity, T&...>)
+				{
+					f(entities[row], std::get<T*>(columns)[row]...);
+				}
+				else
+				{
+					f(std::get<T*>(columns)[row]...);
+				}
+			}
+		});
+	}
+
+	// Calls f(archetype&) for every non-empty archetype containing all of the given types.
+	template <class F>
+	void for_each_archetype(std::span<const type_info> types, F&& f)
+	{
+		for (const auto& arch : archetypes_)
+		{
+			if (arch->size() == 0)
+			{
+				continue;
+			}
+			bool matches = true;
+			for (const type_info& type : types)
+			{
+				matches = matches && arch->contains(type);
+			}
+			if (matches)
+			{
+				f(*arch);
+			}
+		}
+	}
+
+	size_t archetype_count() const { return archetypes_.size(); }
+
+private:
+	struct record
+	{
+		archetype* arch = nullptr;
+		// The entity's row while alive, the next free record otherwise.
+		uint32_t row = 0;
+		uint32_t generation = 0;
+	};
+
+	struct signature_hash
+	{
+		size_t operator()(const std::vector<type_info>& types) const
+		{
+			size_t h = types.size();
+			for (const type_info& t : types)
+			{
+				h ^= t.hash_code() + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+			}
+			return h;
+		}
+	};
+
+	entity allocate_entity()
+	{
+		uint32_t index;
+		if (free_head_ != UINT32_MAX)
+		{
+			index = free_head_;
+			free_head_ = records_[index].row;
+		}
+		else
+		{
+			index = static_cast<uint32_t>(records_.size());
+			records_.emplace_back();
+		}
+		return {index, records_[index].generation};
+	}
+
+	void place(entity e, archetype& arch, size_t row)
+	{
+		records_[e.index].arch = &arch;
+		records_[e.index].row = static_cast<uint32_t>(row);
+	}
+
+	void remove_row(archetype& arch, size_t row)
+	{
+		entity moved = arch.swap_remove(row);
+		if (moved.index != UINT32_MAX)
+		{
+			records_[moved.index].row = static_cast<uint32_t>(row);
+		}
+	}
+
+	archetype* get_archetype(std::vector<const any_type_operations*> ops)
+	{
+		auto arch = std::make_unique<archetype>(std::move(ops));
+		auto [it, inserted] = by_signature_.try_emplace(arch->types_, nullptr);
+		if (inserted)
+		{
+			it->second = arch.get();
+			archetypes_.push_back(std::move(arch));
+		}
+		return it->second;
+	}
+
+	// Drops rows added by create_n whose columns were only partly constructed: every column
+	// before the current one is complete, and the current one has its first rows built.
+	struct drop_rows_on_unwind
+	{
+		archetype* arch;
+		std::span<const any_type_operations* const> ops;
+		size_t first;
+		size_t count;
+		size_t columns = 0;
+		size_t rows = 0;
+
+		~drop_rows_on_unwind()
+		{
+			if (arch == nullptr)
+			{
+				return;
+			}
+			for (size_t c = 0; c < ops.size() && c <= columns; ++c)
+			{
+				const archetype::column_t& column = *arch->find(ops[c]->get_type_info());
+				ops[c]->destruct_n(arch->at(column, first), c < columns ? count : rows);
+			}
+			arch->pop_rows(count);
+		}
+	};
+
+	// Adds a component of the given type to e, or replaces the one it has. construct(dest)
+	// builds the component in uninitialized storage of e's new row and replace(existing)
+	// overwrites the live one. e moves to its new archetype only once construct returns.
+	template <class Construct, class Replace>
+	void* add_component(entity e, const any_type_operations& ops, Construct& construct,
+						Replace& replace)
+	{
+		if (!alive(e))
+		{
+			return nullptr;
+		}
+
+		type_info type = ops.get_type_info();
+		record& r = records_[e.index];
+		archetype& from = *r.arch;
+		if (const archetype::column_t* existing = from.find(type))
+		{
+			void* slot = from.at(*existing, r.row);
+			replace(slot);
+			return slot;
+		}
+
+		archetype*& to = from.add_edges_[type];
+		if (to == nullptr)
+		{
+			std::vector<const any_type_operations*> all{&ops};
+			for (const archetype::column_t& c : from.columns_)
+			{
+				all.push_back(c.ops);
+			}
+			to = get_archetype(std::move(all));
+		}
+
+		archetype* dest = to;
+		size_t row = dest->push_rows({&e, 1});
+		void* slot = dest->at(*dest->find(type), row);
+		{
+			// The new row has no constructed components yet, so dropping it is all the unwind.
+			struct drop_row_on_unwind
+			{
+				archetype* arch;
+
+				~drop_row_on_unwind()
+				{
+					if (arch != nullptr)
+					{
+						arch->pop_rows(1);
+					}
+				}
+			} guard{dest};
+			construct(slot);
+			guard.arch = nullptr;
+		}
+		for (archetype::column_t& c : from.columns_)
+		{
+			c.ops->move(dest->at(*dest->find(c.ops->get_type_info()), row), from.at(c, r.row));
+		}
+		remove_row(from, r.row);
+		place(e, *dest, row);
+		return slot;
+	}
+
+	std::vector<std::unique_ptr<archetype>> archetypes_;
+	std::unordered_map<std::vector<type_info>, archetype*, signature_hash> by_signature_;
+	archetype* empty_ = nullptr;
+	std::vector<record> records_;
+	uint32_t free_head_ = UINT32_MAX;
+};
+
+} // namespace really
@@ -0,0 +1,351 @@
+#pragma once
+
+#include "really/any.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+namespace really
+{
+enum class binary_op : uint8_t
+{
+	add,
+	subtract,
+	multiply,
+	divide,
+	modulo,
+	equal,
+	not_equal,
+	less,
+	less_equal,
+	greater,
+	greater_equal,
+};
+
+inline constexpr size_t binary_op_count = 11;
+
+namespace detail
+{
+// The built-in operator for each binary_op, in declaration order.
+using builtin_binary_ops = std::tuple<std::plus<>, std::minus<>, std::multiplies<>,
+									  std::divides<>, std::modulus<>, std::equal_to<>,
+									  std::not_equal_to<>, std::less<>, std::less_equal<>,
+									  std::greater<>, std::greater_equal<>>;
+
+static_assert(std::tuple_size_v<builtin_binary_ops> == binary_op_count);
+} // namespace detail
+
+class binary_op_table;
+
+// Collects implementations of binary operators for pairs of stored types, and promotions
+// between types, then compiles them into a binary_op_table for dispatch.
+//
+// A pair without an implementation of its own uses the implementation reached by promoting
+// one or both operands, preferring the fewest promotions and then the earliest registered.
+// Promotions are single steps, not chained: register each From -> To that should apply.
+class binary_op_registry
+{
+public:
+	// Computes the result from the two operands and emplaces it into result.
+	using impl_t = std::function<void(const void* lhs, const void* rhs, any<>& result)>;
+	// Converts the value at src and emplaces it into dest.
+	using promotion_t = std::function<void(const void* src, any<>& dest)>;
+
+	binary_op_registry() = default;
+	binary_op_registry(const binary_op_registry&) = delete;
+	binary_op_registry& operator=(const binary_op_registry&) = delete;
+
+	// Registers op on (L, R) performed by func(const L&, const R&). Replaces any earlier one.
+	template <class L, class R, class F>
+		requires std::is_invocable_v<F&, const L&, const R&>
+	void add(binary_op op, F func)
+	{
+		using result_t = std::decay_t<std::invoke_result_t<F&, const L&, const R&>>;
+		impls_.push_back([func = std::move(func)](const void* lhs, const void* rhs,
+												 any<>& result) mutable {
+			const L& l = *static_cast<const L*>(lhs);
+			const R& r = *static_cast<const R*>(rhs);
+			// Evaluators usually reuse one result; assigning over a value of the same type
+			// skips the destroy and construct through the type operations.
+			if (result.operations() == &get_type_operations<result_t>())
+			{
+				*static_cast<result_t*>(result.data()) = func(l, r);
+			}
+			else
+			{
+				result.emplace<result_t>(func(l, r));
+			}
+		});
+		impl_keys_[key(op, intern<L>(), intern<R>())] = &impls_.back();
+	}
+
+	// Registers every binary_op whose built-in operator accepts (const L&, const R&).
+	template <class L, class R = L>
+	void add_builtin()
+	{
+		[this]<size_t... I>(std::index_sequence<I...>) {
+			(add_builtin<L, R, std::tuple_element_t<I, detail::builtin_binary_ops>>(
+				 static_cast<binary_op>(I)),
+			 ...);
+		}(std::make_index_sequence<binary_op_count>());
+	}
+
+	// Registers a promotion performed by func(const From&) -> To.
+	template <class From, class To, class F>
+		requires std::is_invocable_r_v<To, F&, const From&>
+	void promote(F func)
+	{
+		promotions_.push_back([func = std::move(func)](const void* src, any<>& dest) mutable {
+			dest.emplace<To>(func(*static_cast<const From*>(src)));
+		});
+		uint32_t from = intern<From>();
+		uint32_t to = intern<To>();
+		promotion_edges_[from].push_back({to, &promotions_.back()});
+	}
+
+	// Registers a promotion performed by static_cast<To>.
+	template <class From, class To>
+		requires requires(const From& from) { static_cast<To>(from); }
+	void promote()
+	{
+		promote<From, To>([](const From& from) { return static_cast<To>(from); });
+	}
+
+	size_t type_count() const { return types_.size(); }
+
+	// Resolves every (op, lhs, rhs) combination of the registered types. The registry must
+	// outlive the tables compiled from it.
+	binary_op_table compile() const;
+
+private:
+	friend class binary_op_table;
+
+	struct edge
+	{
+		uint32_t to;
+		const promotion_t* promotion;
+	};
+
+	static uint64_t key(binary_op op, uint32_t lhs, uint32_t rhs)
+	{
+		return static_cast<uint64_t>(op) << 48 | static_cast<uint64_t>(lhs) << 24 | rhs;
+	}
+
+	template <class L, class R, class F>
+	void add_builtin(binary_op op)
+	{
+		if constexpr (std::is_invocable_v<F, const L&, const R&>)
+		{
+			add<L, R>(op, F());
+		}
+	}
+
+	template <class T>
+	uint32_t intern()
+	{
+		auto [it, added] =
+			ids_.emplace(really::get_type_info<T>(), static_cast<uint32_t>(types_.size()));
+		if (added)
+		{
+			types_.push_back(&get_type_operations<T>());
+			promotion_edges_.emplace_back();
+		}
+		return it->second;
+	}
+
+	// Indexed by interned type id.
+	std::vector<const any_type_operations*> types_;
+	std::vector<std::vector<edge>> promotion_edges_;
+	std::unordered_map<type_info, uint32_t> ids_;
+
+	std::deque<impl_t> impls_;
+	std::deque<promotion_t> promotions_;
+	std::unordered_map<uint64_t, const impl_t*> impl_keys_;
+};
+
+// An immutable dispatch table compiled from a binary_op_registry. Applying an operator finds
+// each operand's interned type id, indexes one flat table by (op, lhs id, rhs id), and makes
+// one call, plus one per promoted operand. Tables are safe to use from any number of threads.
+class binary_op_table
+{
+public:
+	binary_op_table() = default;
+
+	// Applies op to the values at lhs and rhs, described by their type operations, and puts
+	// the outcome in result. Returns false if no implementation covers the pair.
+	bool apply(binary_op op, const any_type_operations* lhs_ops, const void* lhs,
+			   const any_type_operations* rhs_ops, const void* rhs, any<>& result) const
+	{
+		uint32_t l = find(lhs_ops);
+		uint32_t r = find(rhs_ops);
+		if (l == npos || r == npos)
+		{
+			return false;
+		}
+
+		const entry& e = entries_[(static_cast<size_t>(op) * count_ + l) * count_ + r];
+		if (e.impl == nullptr)
+		{
+			return false;
+		}
+		if (e.lhs == nullptr && e.rhs == nullptr) [[likely]]
+		{
+			(*e.impl)(lhs, rhs, result);
+			return true;
+		}
+
+		any<> promoted[2];
+		if (e.lhs != nullptr)
+		{
+			(*e.lhs)(lhs, promoted[0]);
+			lhs = promoted[0].data();
+		}
+		if (e.rhs != nullptr)
+		{
+			(*e.rhs)(rhs, promoted[1]);
+			rhs = promoted[1].data();
+		}
+		(*e.impl)(lhs, rhs, result);
+		return true;
+	}
+
+	template <any_any L, any_any R>
+	bool apply(binary_op op, const L& lhs, const R& rhs, any<>& result) const
+	{
+		return apply(op, lhs.operations(), lhs.data(), rhs.operations(), rhs.data(), result);
+	}
+
+	// Whether op has an implementation, direct or through promotions, for (lhs, rhs).
+	bool supports(binary_op op, type_info lhs, type_info rhs) const
+	{
+		auto l = ids_.find(lhs);
+		auto r = ids_.find(rhs);
+		return l != ids_.end() && r != ids_.end() &&
+			   entries_[(static_cast<size_t>(op) * count_ + l->second) * count_ + r->second].impl !=
+				   nullptr;
+	}
+
+private:
+	friend class binary_op_registry;
+
+	static constexpr uint32_t npos = UINT32_MAX;
+
+	struct entry
+	{
+		const binary_op_registry::impl_t* impl = nullptr;
+		// Promotions to apply to each operand first, if any.
+		const binary_op_registry::promotion_t* lhs = nullptr;
+		const binary_op_registry::promotion_t* rhs = nullptr;
+	};
+
+	struct id_slot
+	{
+		const any_type_operations* ops = nullptr;
+		uint32_t id = npos;
+	};
+
+	static size_t slot_for(const any_type_operations* ops, size_t mask)
+	{
+		auto h = reinterpret_cast<uintptr_t>(ops) * 0x9e3779b97f4a7c15ull;
+		return static_cast<size_t>(h >> 32) & mask;
+	}
+
+	// Type ids are looked up by operations table address, which is unique per type within a
+	// module. Tables from other modules miss and fall back to the type_info map.
+	uint32_t find(const any_type_operations* ops) const
+	{
+		if (ops == nullptr)
+		{
+			return npos;
+		}
+		size_t mask = id_slots_.size() - 1;
+		for (size_t i = slot_for(ops, mask);; i = (i + 1) & mask)
+		{
+			const id_slot& slot = id_slots_[i];
+			if (slot.ops == ops)
+			{
+				return slot.id;
+			}
+			if (slot.ops == nullptr)
+			{
+				break;
+			}
+		}
+		auto it = ids_.find(ops->get_type_info());
+		return it != ids_.end() ? it->second : npos;
+	}
+
+	size_t count_ = 0;
+	std::vector<entry> entries_;
+	// Open-addressed, at most half full, so probes always reach an empty slot.
+	std::vector<id_slot> id_slots_ = std::vector<id_slot>(1);
+	std::unordered_map<type_info, uint32_t> ids_;
+};
+
+inline binary_op_table binary_op_registry::compile() const
+{
+	binary_op_table table;
+	size_t n = types_.size();
+	table.count_ = n;
+	table.ids_ = ids_;
+
+	size_t slots = 2;
+	while (slots < 2 * n)
+	{
+		slots *= 2;
+	}
+	table.id_slots_.assign(slots, {});
+	for (uint32_t id = 0; id < n; ++id)
+	{
+		size_t i = binary_op_table::slot_for(types_[id], slots - 1);
+		while (table.id_slots_[i].ops != nullptr)
+		{
+			i = (i + 1) & (slots - 1);
+		}
+		table.id_slots_[i] = {types_[id], id};
+	}
+
+	// Each operand can stay as it is or take one of its promotions.
+	auto candidates = [this](uint32_t id) {
+		std::vector<edge> result{{id, nullptr}};
+		result.insert(result.end(), promotion_edges_[id].begin(), promotion_edges_[id].end());
+		return result;
+	};
+
+	table.entries_.resize(binary_op_count * n * n);
+	for (uint32_t l = 0; l < n; ++l)
+	{
+		std::vector<edge> lhs = candidates(l);
+		for (uint32_t r = 0; r < n; ++r)
+		{
+			std::vector<edge> rhs = candidates(r);
+			for (size_t op = 0; op < binary_op_count; ++op)
+			{
+				binary_op_table::entry& best = table.entries_[(op * n + l) * n + r];
+				int best_cost = 3;
+				for (const edge& le : lhs)
+				{
+					for (const edge& re : rhs)
+					{
+						int cost = (le.promotion != nullptr) + (re.promotion != nullptr);
+						auto it = impl_keys_.find(key(static_cast<binary_op>(op), le.to, re.to));
+						if (cost < best_cost && it != impl_keys_.end())
+						{
+							best = {it->second, le.promotion, re.promotion};
+							best_cost = cost;
+						}
+					}
+				}
+			}
+		}
+	}
+	return table;
+}
+} // namespace really
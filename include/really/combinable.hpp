@@ -0,0 +1,237 @@
+#pragma once
+
+#include "really/any.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace really
+{
+namespace detail
+{
+// Slots are padded to this so that threads updating neighbouring slots don't share a line.
+inline constexpr size_t cache_line_size = 64;
+
+inline std::atomic<uint64_t> next_combinable_id{1};
+
+// Each thread remembers its slot in the last few combinables it used, so local() only takes
+// the lock on a thread's first use of a combinable.
+struct combinable_cache
+{
+	static constexpr size_t size = 4;
+
+	struct entry
+	{
+		uint64_t id = 0;
+		void* value = nullptr;
+	};
+
+	entry entries[size];
+	size_t next = 0;
+};
+
+inline thread_local combinable_cache combinable_thread_cache;
+} // namespace detail
+
+// Per-thread partial results of a type known only at runtime, for reductions without a shared
+// lock. Each thread that calls local() gets its own cache-line-padded slot, default-constructed
+// through the type's operations on first use; combine() then merges the slots.
+//
+// local() may be called concurrently. for_each, combine and clear must not run while other
+// threads are still updating their slots.
+class combinable
+{
+public:
+	// ops must describe a default-constructible type; otherwise local() throws
+	// std::invalid_argument.
+	explicit combinable(const any_type_operations& ops)
+		: ops_(&ops), id_(detail::next_combinable_id.fetch_add(1, std::memory_order_relaxed))
+	{
+	}
+
+	template <class T>
+	static combinable of()
+	{
+		static_assert(std::is_default_constructible_v<T>,
+					  "combinable needs a default-constructible type");
+		return combinable(get_type_operations<T>());
+	}
+
+	combinable(const combinable&) = delete;
+	combinable& operator=(const combinable&) = delete;
+
+	~combinable() { clear(); }
+
+	type_info type() const { return ops_->get_type_info(); }
+	const any_type_operations& operations() const { return *ops_; }
+
+	// The calling thread's slot.
+	void* local()
+	{
+		detail::combinable_cache& cache = detail::combinable_thread_cache;
+		for (const detail::combinable_cache::entry& e : cache.entries)
+		{
+			if (e.id == id_)
+			{
+				return e.value;
+			}
+		}
+
+		void* value = find_or_create(std::this_thread::get_id());
+		cache.entries[cache.next] = {id_, value};
+		cache.next = (cache.next + 1) % detail::combinable_cache::size;
+		return value;
+	}
+
+	template <class T>
+	T& local()
+	{
+		assert(type() == really::get_type_info<T>());
+		return *static_cast<T*>(local());
+	}
+
+	// The number of threads that have a slot.
+	size_t size() const
+	{
+		std::lock_guard lock(mutex_);
+		return slots_.size();
+	}
+
+	// Calls f(void*) for every slot.
+	template <class F>
+	void for_each(F&& f) const
+	{
+		std::lock_guard lock(mutex_);
+		for (const slot& s : slots_)
+		{
+			f(s.value);
+		}
+	}
+
+	template <class T, class F>
+	void for_each(F&& f) const
+	{
+		assert(type() == really::get_type_info<T>());
+		for_each([&](void* value) { f(*static_cast<T*>(value)); });
+	}
+
+	// Merges every slot into a copy of the first with merge(void* total, const void* part).
+	// Returns an empty any if no thread has a slot.
+	template <class F>
+	any<> combine(F&& merge) const
+	{
+		std::lock_guard lock(mutex_);
+		any<> total;
+		if (!slots_.empty())
+		{
+			total.copy_from(*ops_, slots_.front().value);
+			for (size_t i = 1; i < slots_.size(); ++i)
+			{
+				merge(total.data(), static_cast<const void*>(slots_[i].value));
+			}
+		}
+		return total;
+	}
+
+	// Folds the slots with f(const T&, const T&) -> T. Returns T() if no thread has a slot.
+	template <class T, class F>
+	T combine(F&& f) const
+	{
+		assert(type() == really::get_type_info<T>());
+		std::lock_guard lock(mutex_);
+		if (slots_.empty())
+		{
+			return T();
+		}
+		T total = *static_cast<const T*>(slots_.front().value);
+		for (size_t i = 1; i < slots_.size(); ++i)
+		{
+			total = f(std::as_const(total), *static_cast<const T*>(slots_[i].value));
+		}
+		return total;
+	}
+
+	// Destroys every slot. Threads calling local() afterwards start from a fresh value.
+	void clear()
+	{
+		std::lock_guard lock(mutex_);
+		for (slot& s : slots_)
+		{
+			ops_->destruct(s.value);
+			::operator delete(s.value, alignment());
+		}
+		slots_.clear();
+		// A new id invalidates every thread's cached slot pointer.
+		id_ = detail::next_combinable_id.fetch_add(1, std::memory_order_relaxed);
+	}
+
+private:
+	struct slot
+	{
+		std::thread::id owner;
+		void* value;
+	};
+
+	std::align_val_t alignment() const
+	{
+		size_t align = ops_->alignment();
+		return static_cast<std::align_val_t>(align > detail::cache_line_size
+												 ? align
+												 : detail::cache_line_size);
+	}
+
+	void* find_or_create(std::thread::id owner)
+	{
+		std::lock_guard lock(mutex_);
+		for (const slot& s : slots_)
+		{
+			if (s.owner == owner)
+			{
+				return s.value;
+			}
+		}
+
+		size_t line = detail::cache_line_size;
+		size_t padded = (ops_->size() + line - 1) / line * line;
+		slots_.reserve(slots_.size() + 1);
+		void* value = ::operator new(padded, alignment());
+
+		// Frees the slot's memory if its value is never constructed.
+		struct delete_on_unwind
+		{
+			void* value;
+			std::align_val_t alignment;
+
+			~delete_on_unwind()
+			{
+				if (value != nullptr)
+				{
+					::operator delete(value, alignment);
+				}
+			}
+		} guard{value, alignment()};
+		if (!ops_->default_construct(value))
+		{
+			throw std::invalid_argument("really::combinable needs a default-constructible type");
+		}
+		guard.value = nullptr;
+		slots_.push_back({owner, value});
+		return value;
+	}
+
+	const any_type_operations* ops_;
+	uint64_t id_;
+	mutable std::mutex mutex_;
+	std::vector<slot> slots_;
+};
+} // namespace really
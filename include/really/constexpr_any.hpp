@@ -0,0 +1,196 @@
+#pragma once
+
+#include "really/any.hpp"
+
+#include <cassert>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+
+namespace really
+{
+namespace detail
+{
+// any_base erases values through void* storage and any_type_operations, neither of which can
+// run in constant evaluation. constexpr_any erases them with a virtual holder instead, which
+// can be allocated, called, downcast and destroyed at compile time.
+class constexpr_holder_base
+{
+public:
+	virtual constexpr type_info type() const = 0;
+	virtual constexpr constexpr_holder_base* clone() const = 0;
+	// Destroys the holder and frees its memory.
+	virtual constexpr void destroy() = 0;
+	virtual void copy_to(any<>& out) const = 0;
+
+protected:
+	constexpr ~constexpr_holder_base() = default;
+};
+
+template <class T>
+class constexpr_holder final : public constexpr_holder_base
+{
+public:
+	template <class... Args>
+	constexpr explicit constexpr_holder(std::in_place_t, Args&&... args)
+		: value(std::forward<Args>(args)...)
+	{
+	}
+
+	// Allocates through std::allocator, the one allocator constant evaluation accepts.
+	template <class... Args>
+	static constexpr constexpr_holder* create(Args&&... args)
+	{
+		constexpr_holder* holder = std::allocator<constexpr_holder>().allocate(1);
+		std::construct_at(holder, std::in_place, std::forward<Args>(args)...);
+		return holder;
+	}
+
+	virtual constexpr type_info type() const { return really::get_type_info<T>(); }
+	virtual constexpr constexpr_holder_base* clone() const { return create(value); }
+
+	virtual constexpr void destroy()
+	{
+		constexpr_holder* self = this;
+		std::destroy_at(self);
+		std::allocator<constexpr_holder>().deallocate(self, 1);
+	}
+
+	virtual void copy_to(any<>& out) const { out.emplace<T>(value); }
+
+	T value;
+};
+} // namespace detail
+
+// A copyable any usable in constant evaluation, for building heterogeneous tables such as
+// configuration defaults at compile time.
+//
+// C++20 allocations can't outlive constant evaluation, so a constexpr_any can't itself be a
+// constexpr variable. Build the table in a constexpr function and read the values out of it
+// in a consteval one; the results are plain constants, with no startup initialization:
+//
+//     constexpr int port = default_setting<int>("port");
+//
+// At runtime it behaves like a heap_any, and to_any() converts it for the rest of the library.
+class constexpr_any
+{
+public:
+	constexpr constexpr_any() = default;
+
+	template <class T>
+		requires(!std::is_same_v<std::remove_cvref_t<T>, constexpr_any> &&
+				 std::is_copy_constructible_v<std::decay_t<T>>)
+	constexpr constexpr_any(T&& value)
+		: holder_(detail::constexpr_holder<std::decay_t<T>>::create(std::forward<T>(value)))
+	{
+	}
+
+	constexpr constexpr_any(const constexpr_any& other)
+		: holder_(other.holder_ != nullptr ? other.holder_->clone() : nullptr)
+	{
+	}
+
+	constexpr constexpr_any(constexpr_any&& other) noexcept
+		: holder_(std::exchange(other.holder_, nullptr))
+	{
+	}
+
+	constexpr ~constexpr_any() { reset(); }
+
+	constexpr constexpr_any& operator=(const constexpr_any& other)
+	{
+		if (this != &other)
+		{
+			reset();
+			holder_ = other.holder_ != nullptr ? other.holder_->clone() : nullptr;
+		}
+		return *this;
+	}
+
+	constexpr constexpr_any& operator=(constexpr_any&& other) noexcept
+	{
+		if (this != &other)
+		{
+			reset();
+			holder_ = std::exchange(other.holder_, nullptr);
+		}
+		return *this;
+	}
+
+	template <class T, class... Args>
+	constexpr std::decay_t<T>& emplace(Args&&... args)
+	{
+		using holder_t = detail::constexpr_holder<std::decay_t<T>>;
+		reset();
+		holder_t* holder = holder_t::create(std::forward<Args>(args)...);
+		holder_ = holder;
+		return holder->value;
+	}
+
+	constexpr void reset()
+	{
+		if (holder_ != nullptr)
+		{
+			std::exchange(holder_, nullptr)->destroy();
+		}
+	}
+
+	constexpr bool has_value() const { return holder_ != nullptr; }
+
+	// The type of the held value, or void if empty.
+	constexpr type_info type() const
+	{
+		return holder_ != nullptr ? holder_->type() : really::get_type_info<void>();
+	}
+
+	template <class T>
+	constexpr bool has_type() const
+	{
+		return holder_ != nullptr && holder_->type() == really::get_type_info<T>();
+	}
+
+	template <class T>
+	constexpr std::decay_t<T>* try_get_value()
+	{
+		return has_type<T>() ? &static_cast<holder_t<T>*>(holder_)->value : nullptr;
+	}
+
+	template <class T>
+	constexpr const std::decay_t<T>* try_get_value() const
+	{
+		return has_type<T>() ? &static_cast<const holder_t<T>*>(holder_)->value : nullptr;
+	}
+
+	template <class T>
+	constexpr std::decay_t<T>& value()
+	{
+		assert(has_type<T>());
+		return static_cast<holder_t<T>*>(holder_)->value;
+	}
+
+	template <class T>
+	constexpr const std::decay_t<T>& value() const
+	{
+		assert(has_type<T>());
+		return static_cast<const holder_t<T>*>(holder_)->value;
+	}
+
+	// A copy of the held value in a runtime any.
+	any<> to_any() const
+	{
+		any<> result;
+		if (holder_ != nullptr)
+		{
+			holder_->copy_to(result);
+		}
+		return result;
+	}
+
+private:
+	template <class T>
+	using holder_t = detail::constexpr_holder<std::decay_t<T>>;
+
+	detail::constexpr_holder_base* holder_ = nullptr;
+};
+} // namespace really
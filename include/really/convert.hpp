@@ -0,0 +1,264 @@
+#pragma once
+
+#include "really/any.hpp"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+
+namespace really
+{
+// A graph of registered From -> To conversions between stored types.
+//
+// Converting finds the shortest chain of registered conversions from the value's dynamic type
+// to the requested one. The composed chain is cached per (from, to) pair in a lock-free table,
+// so after the first conversion of a pair, converting costs one table lookup plus running the
+// chain. Missing paths are cached too.
+class conversion_registry
+{
+public:
+	// A single conversion step. It reads the source value and emplaces the result into dest.
+	using step_t = std::function<void(const void* src, any<>& dest)>;
+
+	conversion_registry() = default;
+	conversion_registry(const conversion_registry&) = delete;
+	conversion_registry& operator=(const conversion_registry&) = delete;
+
+	// Registers a conversion performed by func(const From&) -> To.
+	template <class From, class To, class F>
+		requires std::is_invocable_r_v<To, F&, const From&>
+	void add(F func)
+	{
+		add_step(really::get_type_info<From>(), really::get_type_info<To>(),
+				 [func = std::move(func)](const void* src, any<>& dest) mutable {
+					 dest.emplace<To>(func(*static_cast<const From*>(src)));
+				 });
+	}
+
+	// Registers a conversion performed by static_cast<To>.
+	template <class From, class To>
+		requires requires(const From& from) { static_cast<To>(from); }
+	void add()
+	{
+		add<From, To>([](const From& from) { return static_cast<To>(from); });
+	}
+
+	// Converts the value at src, of dynamic type from, to type to. Returns false if no chain
+	// of conversions connects them.
+	bool convert(const void* src, type_info from, type_info to, any<>& dest) const
+	{
+		const path* p = find_path(from, to);
+		if (p == nullptr)
+		{
+			return false;
+		}
+
+		// Intermediate values of multi-step chains live in a scratch any per step.
+		any<> scratch[2];
+		const void* current = src;
+		for (size_t i = 0; i < p->steps.size(); ++i)
+		{
+			any<>& out = i + 1 == p->steps.size() ? dest : scratch[i % 2];
+			(*p->steps[i])(current, out);
+			current = out.data();
+		}
+		return true;
+	}
+
+	template <class To, any_any Any>
+	std::optional<To> convert(const Any& value) const
+	{
+		if (const To* same = value.template try_get_value<To>())
+		{
+			return *same;
+		}
+		if (!value.has_value())
+		{
+			return std::nullopt;
+		}
+
+		any<> result;
+		if (!convert(value.data(), value.type(), really::get_type_info<To>(), result))
+		{
+			return std::nullopt;
+		}
+		return std::move(result.value<To>());
+	}
+
+	// The registry any_convert uses when none is given.
+	static conversion_registry& global()
+	{
+		static conversion_registry registry;
+		return registry;
+	}
+
+private:
+	struct path
+	{
+		std::vector<const step_t*> steps;
+	};
+
+	struct cache_entry
+	{
+		type_info from;
+		type_info to;
+		uint64_t generation;
+		// Null when the pair has no conversion path.
+		const path* found;
+	};
+
+	static constexpr size_t cache_size = 1024;
+	static constexpr size_t max_probes = 16;
+
+	static size_t slot_for(type_info from, type_info to)
+	{
+		size_t h = from.hash_code() * 0x9e3779b97f4a7c15ull ^ to.hash_code();
+		return (h ^ (h >> 29)) & (cache_size - 1);
+	}
+
+	void add_step(type_info from, type_info to, step_t step)
+	{
+		std::lock_guard lock(mutex_);
+		steps_.push_back(std::move(step));
+		edges_[from].push_back({to, &steps_.back()});
+		// Invalidate every cached path; stale entries are replaced on their next lookup.
+		generation_.fetch_add(1, std::memory_order_release);
+	}
+
+	const path* find_path(type_info from, type_info to) const
+	{
+		uint64_t generation = generation_.load(std::memory_order_acquire);
+		size_t slot = slot_for(from, to);
+		for (size_t probe = 0; probe < max_probes; ++probe)
+		{
+			const cache_entry* entry =
+				cache_[(slot + probe) & (cache_size - 1)].load(std::memory_order_acquire);
+			if (entry == nullptr)
+			{
+				break;
+			}
+			if (entry->from == from && entry->to == to && entry->generation == generation)
+			{
+				return entry->found;
+			}
+		}
+		return resolve(from, to);
+	}
+
+	// Slow path: breadth-first search over the conversion graph, then publish the result.
+	const path* resolve(type_info from, type_info to) const
+	{
+		std::lock_guard lock(mutex_);
+		uint64_t generation = generation_.load(std::memory_order_relaxed);
+
+		// A pair resolved in this generation keeps its path and entry. Only a pair that is new,
+		// or stale after add(), is searched and allocates.
+		resolution& r = resolved_[from][to];
+		if (r.generation != generation || !r.searched)
+		{
+			r = {generation, true, search(from, to), nullptr};
+		}
+
+		// Take the first empty or stale slot in the probe window. When the window is full of
+		// current entries, the result is returned without being cached.
+		size_t slot = slot_for(from, to);
+		for (size_t probe = 0; probe < max_probes; ++probe)
+		{
+			auto& cell = cache_[(slot + probe) & (cache_size - 1)];
+			const cache_entry* existing = cell.load(std::memory_order_relaxed);
+			if (existing == nullptr || existing->generation != generation ||
+				(existing->from == from && existing->to == to))
+			{
+				if (r.entry == nullptr)
+				{
+					// Entries are never freed while the registry lives, so lock-free readers
+					// can't see a dangling pointer.
+					entries_.push_back(
+						std::make_unique<cache_entry>(cache_entry{from, to, generation, r.found}));
+					r.entry = entries_.back().get();
+				}
+				cell.store(r.entry, std::memory_order_release);
+				break;
+			}
+		}
+		return r.found;
+	}
+
+	const path* search(type_info from, type_info to) const
+	{
+		std::unordered_map<type_info, std::pair<type_info, const step_t*>> reached;
+		std::deque<type_info> frontier{from};
+		reached.emplace(from, std::pair{from, nullptr});
+		while (!frontier.empty() && !reached.contains(to))
+		{
+			type_info current = frontier.front();
+			frontier.pop_front();
+			auto it = edges_.find(current);
+			if (it == edges_.end())
+			{
+				continue;
+			}
+			for (const edge& e : it->second)
+			{
+				if (reached.emplace(e.to, std::pair{current, e.step}).second)
+				{
+					frontier.push_back(e.to);
+				}
+			}
+		}
+
+		if (from == to || !reached.contains(to))
+		{
+			return nullptr;
+		}
+		auto p = std::make_unique<path>();
+		for (type_info t = to; t != from; t = reached.at(t).first)
+		{
+			p->steps.insert(p->steps.begin(), reached.at(t).second);
+		}
+		paths_.push_back(std::move(p));
+		return paths_.back().get();
+	}
+
+	struct edge
+	{
+		type_info to;
+		const step_t* step;
+	};
+
+	mutable std::mutex mutex_;
+	std::deque<step_t> steps_;
+	std::unordered_map<type_info, std::vector<edge>> edges_;
+	std::atomic<uint64_t> generation_ = 0;
+
+	mutable std::atomic<const cache_entry*> cache_[cache_size] = {};
+	// The latest search for each pair, guarded by mutex_.
+	struct resolution
+	{
+		uint64_t generation = 0;
+		bool searched = false;
+		const path* found = nullptr;
+		const cache_entry* entry = nullptr;
+	};
+
+	mutable std::unordered_map<type_info, std::unordered_map<type_info, resolution>> resolved_;
+	mutable std::vector<std::unique_ptr<path>> paths_;
+	mutable std::vector<std::unique_ptr<cache_entry>> entries_;
+};
+
+// Returns the value held by any converted to To, either directly or through the shortest
+// chain of registered conversions, or nullopt if there is none.
+template <class To, any_any Any>
+std::optional<To> any_convert(const Any& value,
+							  const conversion_registry& registry = conversion_registry::global())
+{
+	return registry.template convert<To>(value);
+}
+
+} // namespace really
@@ -0,0 +1,526 @@
+#pragma once
+
+#include "really/any.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+// Records whose field types are only known at runtime.
+//
+// A schema is computed once from a list of (name, type operations) pairs and fixes each
+// field's offset. Records built from it keep all fields in a single allocation and construct,
+// copy and destroy them through the per-field operations.
+namespace really
+{
+struct field_desc
+{
+	std::string name;
+	const any_type_operations* ops;
+};
+
+// Typed access to one field of a schema, resolved once so record access is a plain offset.
+template <class T>
+struct field_ref
+{
+	size_t offset = SIZE_MAX;
+
+	bool valid() const { return offset != SIZE_MAX; }
+};
+
+class schema
+{
+public:
+	struct field
+	{
+		std::string name;
+		const any_type_operations* ops;
+		size_t offset;
+	};
+
+	explicit schema(std::vector<field_desc> fields)
+	{
+		fields_.reserve(fields.size());
+		for (field_desc& f : fields)
+		{
+			fields_.push_back({std::move(f.name), f.ops, 0});
+		}
+
+		// Lay fields out by decreasing alignment, which leaves no padding between them, while
+		// keeping declaration order for indices.
+		std::vector<size_t> order(fields_.size());
+		for (size_t i = 0; i < order.size(); ++i)
+		{
+			order[i] = i;
+		}
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+			return fields_[a].ops->alignment() > fields_[b].ops->alignment();
+		});
+
+		for (size_t i : order)
+		{
+			size_t align = fields_[i].ops->alignment();
+			size_ = (size_ + align - 1) / align * align;
+			fields_[i].offset = size_;
+			size_ += fields_[i].ops->size();
+			alignment_ = std::max(alignment_, align);
+			construct_support_ =
+				detail::weaker(construct_support_, fields_[i].ops->construct_support());
+			assign_support_ = detail::weaker(assign_support_, fields_[i].ops->assign_support());
+		}
+		size_ = std::max<size_t>(1, (size_ + alignment_ - 1) / alignment_ * alignment_);
+	}
+
+	schema(std::initializer_list<field_desc> fields) : schema(std::vector<field_desc>(fields)) {}
+
+	// Size and alignment of one record's block. size() is a multiple of alignment(), so
+	// records can also be packed into an array.
+	size_t size() const { return size_; }
+	size_t alignment() const { return alignment_; }
+
+	// The weakest copy and move support among the field types. copy needs copy_and_move
+	// construction, move at least move_only, and copy_assign copy_and_move assignment.
+	any_copy_support construct_support() const { return construct_support_; }
+	any_copy_support assign_support() const { return assign_support_; }
+
+	size_t field_count() const { return fields_.size(); }
+	const field& field_at(size_t index) const { return fields_[index]; }
+
+	// Returns the index of the named field, or SIZE_MAX.
+	size_t index_of(std::string_view name) const
+	{
+		for (size_t i = 0; i < fields_.size(); ++i)
+		{
+			if (fields_[i].name == name)
+			{
+				return i;
+			}
+		}
+		return SIZE_MAX;
+	}
+
+	// Resolves a named field of type T. The result is invalid if there is no such field or
+	// it has a different type.
+	template <class T>
+	field_ref<T> find(std::string_view name) const
+	{
+		size_t index = index_of(name);
+		if (index == SIZE_MAX ||
+			fields_[index].ops->get_type_info() != really::get_type_info<T>())
+		{
+			return {};
+		}
+		return {fields_[index].offset};
+	}
+
+	// Block operations. Each throws std::invalid_argument, before touching the block, for a
+	// field type lacking the operation. If construct or copy throws, the fields already built
+	// are destroyed, so the block holds no live fields.
+	void construct(void* block) const
+	{
+		size_t built = 0;
+		destroy_on_unwind guard{this, block, &built};
+		for (; built < fields_.size(); ++built)
+		{
+			const field& f = fields_[built];
+			if (!f.ops->default_construct(at(block, f)))
+			{
+				throw std::invalid_argument("really::schema field '" + f.name +
+											"' is not default constructible");
+			}
+		}
+		guard.built = nullptr;
+	}
+
+	void copy(void* dest, const void* src) const
+	{
+		require(construct_support_, &any_type_operations::construct_support,
+				any_copy_support::copy_and_move, "copy constructible");
+		size_t built = 0;
+		destroy_on_unwind guard{this, dest, &built};
+		for (; built < fields_.size(); ++built)
+		{
+			const field& f = fields_[built];
+			f.ops->copy(at(dest, f), at(src, f));
+		}
+		guard.built = nullptr;
+	}
+
+	void copy_assign(void* dest, const void* src) const
+	{
+		require(assign_support_, &any_type_operations::assign_support,
+				any_copy_support::copy_and_move, "copy assignable");
+		for (const field& f : fields_)
+		{
+			f.ops->copy_assign(at(dest, f), at(src, f));
+		}
+	}
+
+	void move(void* dest, void* src) const
+	{
+		require(construct_support_, &any_type_operations::construct_support,
+				any_copy_support::move_only, "move constructible");
+		for (const field& f : fields_)
+		{
+			f.ops->move(at(dest, f), at(src, f));
+		}
+	}
+
+	void destruct(void* block) const
+	{
+		for (const field& f : fields_)
+		{
+			f.ops->destruct(at(block, f));
+		}
+	}
+
+	void* allocate() const
+	{
+		return ::operator new(size_, static_cast<std::align_val_t>(alignment_));
+	}
+
+	void deallocate(void* block) const
+	{
+		::operator delete(block, static_cast<std::align_val_t>(alignment_));
+	}
+
+	static void* at(void* block, const field& f)
+	{
+		return static_cast<std::byte*>(block) + f.offset;
+	}
+
+	static const void* at(const void* block, const field& f)
+	{
+		return static_cast<const std::byte*>(block) + f.offset;
+	}
+
+private:
+	// Destroys the first *built fields of a block whose construction did not finish.
+	struct destroy_on_unwind
+	{
+		const schema* self;
+		void* block;
+		const size_t* built;
+
+		~destroy_on_unwind()
+		{
+			for (size_t i = 0; built != nullptr && i < *built; ++i)
+			{
+				self->fields_[i].ops->destruct(at(block, self->fields_[i]));
+			}
+		}
+	};
+
+	// Throws naming the first field whose type's support falls short of needed.
+	void require(any_copy_support weakest, any_copy_support (any_type_operations::*support)() const,
+				 any_copy_support needed, const char* what) const
+	{
+		if (weakest >= needed)
+		{
+			return;
+		}
+		for (const field& f : fields_)
+		{
+			if ((f.ops->*support)() < needed)
+			{
+				throw std::invalid_argument("really::schema field '" + f.name + "' is not " +
+											what);
+			}
+		}
+	}
+
+	std::vector<field> fields_;
+	size_t size_ = 0;
+	size_t alignment_ = 1;
+	any_copy_support construct_support_ = any_copy_support::copy_and_move;
+	any_copy_support assign_support_ = any_copy_support::copy_and_move;
+};
+
+// A non-owning view of one record's fields.
+template <class Byte>
+class basic_record_view
+{
+public:
+	basic_record_view(const schema& s, Byte* block) : schema_(&s), block_(block) {}
+
+	template <class OtherByte>
+		requires(std::is_const_v<Byte> && !std::is_const_v<OtherByte>)
+	basic_record_view(basic_record_view<OtherByte> other)
+		: schema_(&other.get_schema()), block_(other.data())
+	{
+	}
+
+	const really::schema& get_schema() const { return *schema_; }
+	Byte* data() const { return block_; }
+
+	// Unchecked access through a resolved field reference.
+	template <class T>
+	auto& operator[](field_ref<T> ref) const
+	{
+		assert(ref.valid());
+		using value_t = std::conditional_t<std::is_const_v<Byte>, const T, T>;
+		return *std::launder(reinterpret_cast<value_t*>(block_ + ref.offset));
+	}
+
+	// Untyped access by field index.
+	auto* get(size_t index) const { return schema::at(block_, schema_->field_at(index)); }
+
+	// Checked access by field index. Returns nullptr if the field holds another type.
+	template <class T>
+	auto* get(size_t index) const
+	{
+		using value_t = std::conditional_t<std::is_const_v<Byte>, const T, T>;
+		const schema::field& f = schema_->field_at(index);
+		return f.ops->get_type_info() == really::get_type_info<T>()
+				   ? static_cast<value_t*>(schema::at(block_, f))
+				   : nullptr;
+	}
+
+	// Checked access by field name.
+	template <class T>
+	auto* get(std::string_view name) const
+	{
+		size_t index = schema_->index_of(name);
+		using value_t = std::conditional_t<std::is_const_v<Byte>, const T, T>;
+		return index != SIZE_MAX ? get<T>(index) : static_cast<value_t*>(nullptr);
+	}
+
+private:
+	const schema* schema_;
+	Byte* block_;
+};
+
+using record_view = basic_record_view<std::byte>;
+using const_record_view = basic_record_view<const std::byte>;
+
+// A single record owning one block for all of its fields. The schema must outlive it.
+class record
+{
+public:
+	explicit record(const schema& s)
+		: schema_(&s), block_(static_cast<std::byte*>(s.allocate()))
+	{
+		deallocate_on_unwind guard{this};
+		s.construct(block_);
+		guard.self = nullptr;
+	}
+
+	record(const record& other)
+		: schema_(other.schema_), block_(static_cast<std::byte*>(schema_->allocate()))
+	{
+		deallocate_on_unwind guard{this};
+		schema_->copy(block_, other.block_);
+		guard.self = nullptr;
+	}
+
+	record(record&& other) noexcept : schema_(other.schema_), block_(other.block_)
+	{
+		other.block_ = nullptr;
+	}
+
+	record& operator=(const record& other)
+	{
+		if (this != &other)
+		{
+			if (schema_ == other.schema_ && block_ != nullptr &&
+				schema_->assign_support() == any_copy_support::copy_and_move)
+			{
+				schema_->copy_assign(block_, other.block_);
+			}
+			else
+			{
+				*this = record(other);
+			}
+		}
+		return *this;
+	}
+
+	record& operator=(record&& other) noexcept
+	{
+		std::swap(schema_, other.schema_);
+		std::swap(block_, other.block_);
+		return *this;
+	}
+
+	~record()
+	{
+		if (block_ != nullptr)
+		{
+			schema_->destruct(block_);
+			schema_->deallocate(block_);
+		}
+	}
+
+	const really::schema& get_schema() const { return *schema_; }
+
+	record_view view() { return {*schema_, block_}; }
+	const_record_view view() const { return {*schema_, block_}; }
+
+	template <class T>
+	T& operator[](field_ref<T> ref)
+	{
+		return view()[ref];
+	}
+
+	template <class T>
+	const T& operator[](field_ref<T> ref) const
+	{
+		return view()[ref];
+	}
+
+	template <class T>
+	T* get(size_t index)
+	{
+		return view().get<T>(index);
+	}
+
+	template <class T>
+	T* get(std::string_view name)
+	{
+		return view().get<T>(name);
+	}
+
+private:
+	// Frees the block of a record whose constructor throws; its fields are already destroyed.
+	struct deallocate_on_unwind
+	{
+		record* self;
+
+		~deallocate_on_unwind()
+		{
+			if (self != nullptr)
+			{
+				self->schema_->deallocate(self->block_);
+			}
+		}
+	};
+
+	const schema* schema_;
+	std::byte* block_;
+};
+
+// A batch of records packed into one contiguous array.
+class record_array
+{
+public:
+	explicit record_array(const schema& s) : schema_(&s) {}
+
+	record_array(const record_array&) = delete;
+	record_array& operator=(const record_array&) = delete;
+
+	~record_array()
+	{
+		clear();
+		if (data_ != nullptr)
+		{
+			deallocate(data_);
+		}
+	}
+
+	size_t size() const { return size_; }
+	bool empty() const { return size_ == 0; }
+
+	// Appends a default-constructed record.
+	record_view emplace_back()
+	{
+		reserve_for_one();
+		std::byte* block = block_at(size_);
+		schema_->construct(block);
+		++size_;
+		return {*schema_, block};
+	}
+
+	// Appends a copy of an existing record with the same schema.
+	record_view push_back(const_record_view value)
+	{
+		assert(&value.get_schema() == schema_);
+		reserve_for_one();
+		std::byte* block = block_at(size_);
+		schema_->copy(block, value.data());
+		++size_;
+		return {*schema_, block};
+	}
+
+	void pop_back()
+	{
+		assert(size_ > 0);
+		--size_;
+		schema_->destruct(block_at(size_));
+	}
+
+	void clear()
+	{
+		while (size_ > 0)
+		{
+			pop_back();
+		}
+	}
+
+	void reserve(size_t capacity)
+	{
+		if (capacity <= capacity_)
+		{
+			return;
+		}
+		if (size_ > 0 && schema_->construct_support() == any_copy_support::no_copy_or_move)
+		{
+			throw std::invalid_argument("really::record_array cannot relocate records with an "
+										"immovable field");
+		}
+
+		auto* data = static_cast<std::byte*>(::operator new(
+			capacity * schema_->size(), static_cast<std::align_val_t>(schema_->alignment())));
+		for (size_t i = 0; i < size_; ++i)
+		{
+			schema_->move(data + i * schema_->size(), block_at(i));
+			schema_->destruct(block_at(i));
+		}
+		if (data_ != nullptr)
+		{
+			deallocate(data_);
+		}
+		data_ = data;
+		capacity_ = capacity;
+	}
+
+	record_view operator[](size_t index) { return {*schema_, block_at(index)}; }
+	const_record_view operator[](size_t index) const { return {*schema_, block_at(index)}; }
+
+	// Iterates one field across all records, which is a fixed-stride walk over the array.
+	template <class T, class F>
+	void for_each(field_ref<T> ref, F&& f)
+	{
+		assert(ref.valid());
+		for (size_t i = 0; i < size_; ++i)
+		{
+			f(*std::launder(reinterpret_cast<T*>(block_at(i) + ref.offset)));
+		}
+	}
+
+private:
+	std::byte* block_at(size_t index) const { return data_ + index * schema_->size(); }
+
+	void reserve_for_one()
+	{
+		if (size_ == capacity_)
+		{
+			reserve(capacity_ == 0 ? 8 : capacity_ * 2);
+		}
+	}
+
+	void deallocate(std::byte* data)
+	{
+		::operator delete(data, static_cast<std::align_val_t>(schema_->alignment()));
+	}
+
+	const schema* schema_;
+	std::byte* data_ = nullptr;
+	size_t size_ = 0;
+	size_t capacity_ = 0;
+};
+
+} // namespace really
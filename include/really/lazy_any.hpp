@@ -0,0 +1,175 @@
+#pragma once
+
+#include "really/any.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+
+namespace really
+{
+// An any holding a factory for its value instead of the value, for values that are often never
+// read, such as optional attributes or speculative results. Until first access it costs only
+// the factory's captures, kept inline when they are small.
+//
+// The value's type is known up front, so type() and has_type() never run the factory. The first
+// value(), try_get_value() of that type or materialize() runs it exactly once, even when several
+// threads get there together; the others wait for it. If the factory throws, the next access
+// runs it again. From then on the value is an ordinary any<>.
+//
+// Const accessors are safe to call concurrently. Moving, resetting or assigning is not.
+class lazy_any
+{
+public:
+	lazy_any() = default;
+
+	template <class F>
+		requires(!std::is_same_v<std::decay_t<F>, lazy_any> &&
+				 std::is_invocable_v<std::decay_t<F>&>)
+	explicit lazy_any(F&& factory)
+		: run_(&run_factory<std::decay_t<F>>),
+		  type_(really::get_type_info<result_t<F>>()),
+		  state_(pending)
+	{
+		static_assert(!std::is_void_v<result_t<F>>, "the factory must return the value");
+		factory_.emplace<std::decay_t<F>>(std::forward<F>(factory));
+	}
+
+	lazy_any(lazy_any&& other) noexcept
+		: factory_(std::move(other.factory_)),
+		  value_(std::move(other.value_)),
+		  run_(other.run_),
+		  type_(other.type_),
+		  state_(other.state_.exchange(ready, std::memory_order_relaxed))
+	{
+		other.type_ = really::get_type_info<void>();
+	}
+
+	lazy_any& operator=(lazy_any&& other) noexcept
+	{
+		if (this != &other)
+		{
+			factory_ = std::move(other.factory_);
+			value_ = std::move(other.value_);
+			run_ = other.run_;
+			type_ = std::exchange(other.type_, really::get_type_info<void>());
+			state_.store(other.state_.exchange(ready, std::memory_order_relaxed),
+						 std::memory_order_relaxed);
+		}
+		return *this;
+	}
+
+	void reset()
+	{
+		factory_.reset();
+		value_.reset();
+		type_ = really::get_type_info<void>();
+		state_.store(ready, std::memory_order_relaxed);
+	}
+
+	bool has_value() const { return type_ != really::get_type_info<void>(); }
+
+	// Whether the factory has run, or there never was one.
+	bool is_materialized() const { return state_.load(std::memory_order_acquire) == ready; }
+
+	// The type the factory produces, or void if empty.
+	type_info type() const { return type_; }
+
+	template <class T>
+	bool has_type() const
+	{
+		return type_ == really::get_type_info<T>();
+	}
+
+	// The value, running the factory if it hasn't run yet.
+	const any<>& materialize() const
+	{
+		if (state_.load(std::memory_order_acquire) != ready) [[unlikely]]
+		{
+			materialize_slow();
+		}
+		return value_;
+	}
+
+	// Null without running the factory if T is not the factory's type.
+	template <class T>
+	const std::decay_t<T>* try_get_value() const
+	{
+		return has_type<T>() ? materialize().template try_get_value<T>() : nullptr;
+	}
+
+	template <class T>
+	const std::decay_t<T>& value() const
+	{
+		assert(has_type<T>());
+		return *materialize().template try_get_value<T>();
+	}
+
+private:
+	enum state : uint8_t
+	{
+		pending,
+		running,
+		ready,
+	};
+
+	template <class F>
+	using result_t = std::decay_t<std::invoke_result_t<std::decay_t<F>&>>;
+
+	template <class F>
+	static void run_factory(movable_any& factory, any<>& value)
+	{
+		F& f = *factory.try_get_value<F>();
+		value.emplace<result_t<F>>(f());
+	}
+
+	void materialize_slow() const
+	{
+		uint8_t current = state_.load(std::memory_order_acquire);
+		while (current != ready)
+		{
+			if (current == running)
+			{
+				state_.wait(running, std::memory_order_acquire);
+				current = state_.load(std::memory_order_acquire);
+				continue;
+			}
+			if (!state_.compare_exchange_weak(current, running, std::memory_order_acquire))
+			{
+				continue;
+			}
+
+			// Hands the factory to the next caller if this run ends in an exception.
+			struct reopen_on_unwind
+			{
+				const lazy_any* self;
+
+				~reopen_on_unwind()
+				{
+					if (self != nullptr)
+					{
+						self->state_.store(pending, std::memory_order_relaxed);
+						self->state_.notify_all();
+					}
+				}
+			} reopen{this};
+
+			run_(factory_, value_);
+			factory_.reset();
+			reopen.self = nullptr;
+			state_.store(ready, std::memory_order_release);
+			state_.notify_all();
+			return;
+		}
+	}
+
+	// Written only by the caller that wins the pending -> running transition.
+	mutable movable_any factory_;
+	mutable any<> value_;
+	void (*run_)(movable_any& factory, any<>& value) = nullptr;
+	type_info type_ = really::get_type_info<void>();
+	mutable std::atomic<uint8_t> state_{ready};
+};
+} // namespace really
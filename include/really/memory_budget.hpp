@@ -0,0 +1,258 @@
+#pragma once
+
+#include "really/any.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+namespace really
+{
+// The state of a memory_budget at one moment.
+struct memory_budget_snapshot
+{
+	std::string_view name;
+	size_t limit;
+	// Bytes charged, including those threads have reserved but not yet used.
+	size_t used;
+	size_t peak;
+	// Allocations refused because they would have gone over the limit.
+	uint64_t failures;
+};
+
+// Heap usage of the type-erased values belonging to one subsystem, with an optional hard limit.
+//
+// Threads take bytes from the shared counter in batches and keep the unused remainder, so
+// most charges and releases touch only thread-local state. The shared count is an upper bound:
+// it can run ahead of real usage by up to two batches per thread. A batch size of 0 makes the
+// accounting exact at the cost of one atomic operation per allocation.
+//
+// Budgets must outlive every thread that allocates against them; they are typically globals.
+class memory_budget
+{
+public:
+	static constexpr size_t unlimited = SIZE_MAX;
+
+	explicit memory_budget(std::string_view name, size_t limit = unlimited,
+						   size_t batch_size = 64 * 1024)
+		: name_(name), limit_(limit), batch_size_(batch_size)
+	{
+	}
+
+	memory_budget(const memory_budget&) = delete;
+	memory_budget& operator=(const memory_budget&) = delete;
+
+	std::string_view name() const { return name_; }
+
+	size_t limit() const { return limit_.load(std::memory_order_relaxed); }
+	// Lowering the limit below current use only refuses new allocations.
+	void set_limit(size_t limit) { limit_.store(limit, std::memory_order_relaxed); }
+
+	memory_budget_snapshot snapshot() const
+	{
+		return {name_, limit(), used_.load(std::memory_order_relaxed),
+				peak_.load(std::memory_order_relaxed), failures_.load(std::memory_order_relaxed)};
+	}
+
+	// Charges size bytes, or returns false and charges nothing if that would exceed the limit.
+	bool try_charge(size_t size)
+	{
+		size_t& reserved = local_reserve();
+		if (reserved >= size)
+		{
+			reserved -= size;
+			return true;
+		}
+
+		size_t needed = size - reserved;
+		size_t grant = needed > batch_size_ ? needed : batch_size_;
+		if (!acquire(grant, limit()) && (grant == needed || !acquire(grant = needed, limit())))
+		{
+			failures_.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		reserved = reserved + grant - size;
+		return true;
+	}
+
+	// Charges size bytes regardless of the limit.
+	void charge(size_t size)
+	{
+		size_t& reserved = local_reserve();
+		if (reserved < size)
+		{
+			size_t grant = size - reserved > batch_size_ ? size - reserved : batch_size_;
+			acquire(grant, unlimited);
+			reserved += grant;
+		}
+		reserved -= size;
+	}
+
+	void release(size_t size)
+	{
+		size_t& reserved = local_reserve();
+		reserved += size;
+		if (reserved > 2 * batch_size_)
+		{
+			used_.fetch_sub(reserved - batch_size_, std::memory_order_relaxed);
+			reserved = batch_size_;
+		}
+	}
+
+private:
+	struct reserve
+	{
+		memory_budget* budget;
+		size_t bytes;
+	};
+
+	// Each thread's unused bytes for every budget it has touched, handed back when it exits.
+	struct thread_reserves
+	{
+		std::vector<reserve> entries;
+
+		~thread_reserves()
+		{
+			for (const reserve& r : entries)
+			{
+				r.budget->used_.fetch_sub(r.bytes, std::memory_order_relaxed);
+			}
+		}
+	};
+
+	size_t& local_reserve()
+	{
+		thread_local thread_reserves reserves;
+		for (reserve& r : reserves.entries)
+		{
+			if (r.budget == this)
+			{
+				return r.bytes;
+			}
+		}
+		return reserves.entries.emplace_back(reserve{this, 0}).bytes;
+	}
+
+	bool acquire(size_t size, size_t limit)
+	{
+		size_t used = used_.load(std::memory_order_relaxed);
+		do
+		{
+			if (size > limit || used > limit - size)
+			{
+				return false;
+			}
+		} while (!used_.compare_exchange_weak(used, used + size, std::memory_order_relaxed));
+
+		size_t peak = peak_.load(std::memory_order_relaxed);
+		while (used + size > peak &&
+			   !peak_.compare_exchange_weak(peak, used + size, std::memory_order_relaxed))
+		{
+		}
+		return true;
+	}
+
+	std::string_view name_;
+	std::atomic<size_t> limit_;
+	size_t batch_size_;
+	std::atomic<size_t> used_{0};
+	std::atomic<size_t> peak_{0};
+	std::atomic<uint64_t> failures_{0};
+};
+
+namespace detail
+{
+// Wraps a storage policy and charges its heap allocations to Budget. Values held inline cost
+// nothing. An allocation that would exceed the budget's limit is refused: allocate throws
+// std::bad_alloc and try_allocate, used by try_emplace and try_assign, returns false. Either
+// way the storage stays empty.
+template <any_storage Inner, memory_budget& Budget>
+struct budgeted_storage : Inner
+{
+	void allocate(size_t size)
+	{
+		if (!try_allocate(size))
+		{
+			throw std::bad_alloc();
+		}
+	}
+
+	bool try_allocate(size_t size)
+	{
+		size_t bytes = heap_bytes(size);
+		if (bytes != 0 && !Budget.try_charge(bytes))
+		{
+			return false;
+		}
+		charged_ = bytes;
+		Inner::allocate(size);
+		return true;
+	}
+
+	void free()
+	{
+		Inner::free();
+		if (charged_ != 0)
+		{
+			Budget.release(std::exchange(charged_, 0));
+		}
+	}
+
+	bool try_swap(budgeted_storage* other)
+	{
+		if (Inner::try_swap(other))
+		{
+			std::swap(charged_, other->charged_);
+			return true;
+		}
+		return false;
+	}
+
+private:
+	static size_t heap_bytes(size_t size)
+	{
+		return size <= storage_inline_capacity<Inner> ? 0 : size;
+	}
+
+	size_t charged_ = 0;
+};
+
+template <any_storage Inner, memory_budget& Budget>
+constexpr size_t storage_inline_capacity<budgeted_storage<Inner, Budget>> =
+	storage_inline_capacity<Inner>;
+} // namespace detail
+
+// An any whose heap allocations are charged to Budget, which must have static storage
+// duration:
+//
+//     inline really::memory_budget session_budget("session store", 256 << 20);
+//     using session_any = really::budgeted_any<session_budget>;
+//
+// Going over the limit makes emplace, assignment and copies throw std::bad_alloc, leaving the
+// any empty; try_emplace and try_assign return failure instead.
+template <memory_budget& Budget, any_copy_support CopySupport = any_copy_support::copy_and_move>
+class budgeted_any
+	: public detail::any_base<
+		  detail::budgeted_storage<detail::any_small_buffer_storage<2 * sizeof(void*) - 1>, Budget>,
+		  CopySupport>
+{
+	using base_t = detail::any_base<
+		detail::budgeted_storage<detail::any_small_buffer_storage<2 * sizeof(void*) - 1>, Budget>,
+		CopySupport>;
+
+public:
+	using base_t::base_t;
+	using base_t::operator=;
+
+	budgeted_any() = default;
+	budgeted_any(const budgeted_any&) = default;
+	budgeted_any& operator=(const budgeted_any&) = default;
+	budgeted_any(budgeted_any&&) noexcept = default;
+	budgeted_any& operator=(budgeted_any&&) noexcept = default;
+};
+} // namespace really
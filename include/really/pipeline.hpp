@@ -0,0 +1,624 @@
+#pragma once
+
+#include "really/any.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// Multi-stage dataflow pipelines over type-erased values.
+//
+// Stages are connected by bounded buffers of movable_any. Values are relocated from stage to
+// stage (heap payloads change hands by pointer swap), never copied. Workers pull from their
+// input buffer in batches, so synchronization is paid per batch rather than per item, and a
+// full buffer blocks its producers (backpressure).
+namespace really
+{
+struct pipeline_options
+{
+	// Capacity of each inter-stage buffer, in items.
+	size_t buffer_capacity = 1024;
+	// Maximum number of items a worker pulls from its input buffer at once.
+	size_t batch_size = 32;
+};
+
+struct stage_options
+{
+	std::string name;
+	size_t parallelism = 1;
+	// Ordered stages emit batches in the order they were pulled, even with several workers.
+	bool ordered = true;
+};
+
+struct stage_stats
+{
+	std::string name;
+	type_info input_type;
+	type_info output_type;
+	uint64_t items_in = 0;
+	uint64_t items_out = 0;
+	// Items whose dynamic type did not match what the stage accepts.
+	uint64_t type_mismatches = 0;
+	uint64_t batches = 0;
+	double busy_seconds = 0;
+	double items_per_second = 0;
+	// Depth of the stage's input buffer.
+	size_t queue_depth = 0;
+	size_t max_queue_depth = 0;
+};
+
+namespace detail
+{
+// A bounded multi-producer/multi-consumer FIFO of movable_any.
+class any_buffer
+{
+public:
+	explicit any_buffer(size_t capacity) : ring_(capacity == 0 ? 1 : capacity) {}
+
+	// Moves all of items into the buffer, blocking while it is full. Returns false if the
+	// buffer was closed before everything could be pushed.
+	bool push(movable_any* items, size_t count)
+	{
+		std::unique_lock lock(mutex_);
+		while (count > 0)
+		{
+			not_full_.wait(lock, [&] { return closed_ || count_ < ring_.size(); });
+			if (closed_)
+			{
+				return false;
+			}
+
+			size_t n = std::min(count, ring_.size() - count_);
+			for (size_t i = 0; i < n; ++i)
+			{
+				ring_[(head_ + count_ + i) % ring_.size()] = std::move(items[i]);
+			}
+			items += n;
+			count -= n;
+			count_ += n;
+			max_depth_ = std::max(max_depth_, count_);
+			not_empty_.notify_all();
+		}
+		return true;
+	}
+
+	// Moves up to max items out of the buffer, blocking until at least one is available.
+	// Returns 0 once the buffer is closed and drained. ticket receives the sequence number of
+	// the batch, which ordered stages use to re-establish order downstream.
+	size_t pop(movable_any* out, size_t max, uint64_t* ticket)
+	{
+		std::unique_lock lock(mutex_);
+		not_empty_.wait(lock, [&] { return closed_ || count_ > 0; });
+
+		size_t n = std::min(max, count_);
+		for (size_t i = 0; i < n; ++i)
+		{
+			out[i] = std::move(ring_[(head_ + i) % ring_.size()]);
+		}
+		head_ = (head_ + n) % ring_.size();
+		count_ -= n;
+		if (n > 0)
+		{
+			*ticket = next_ticket_++;
+			not_full_.notify_all();
+		}
+		return n;
+	}
+
+	void close()
+	{
+		std::lock_guard lock(mutex_);
+		closed_ = true;
+		not_empty_.notify_all();
+		not_full_.notify_all();
+	}
+
+	size_t depth() const
+	{
+		std::lock_guard lock(mutex_);
+		return count_;
+	}
+
+	size_t max_depth() const
+	{
+		std::lock_guard lock(mutex_);
+		return max_depth_;
+	}
+
+private:
+	mutable std::mutex mutex_;
+	std::condition_variable not_empty_;
+	std::condition_variable not_full_;
+	std::vector<movable_any> ring_;
+	size_t head_ = 0;
+	size_t count_ = 0;
+	size_t max_depth_ = 0;
+	uint64_t next_ticket_ = 0;
+	bool closed_ = false;
+};
+
+// Type-erased stage body. process() consumes in and either fills out or leaves it empty to
+// drop the item. It returns false if in did not hold an acceptable type.
+class pipeline_stage
+{
+public:
+	virtual ~pipeline_stage() = default;
+	virtual bool process(movable_any& in, movable_any& out) = 0;
+
+	stage_options options;
+	type_info input_type;
+	type_info output_type;
+};
+
+template <class T>
+struct stage_output
+{
+	using type = T;
+};
+
+template <class T>
+struct stage_output<std::optional<T>>
+{
+	using type = T;
+};
+
+template <class T>
+struct is_optional : std::false_type
+{
+};
+
+template <class T>
+struct is_optional<std::optional<T>> : std::true_type
+{
+};
+
+// Adapts a callable taking In to a pipeline stage. In == movable_any receives the item as-is.
+// A callable returning std::optional drops the item when it returns nullopt, and a callable
+// returning void is a sink.
+template <class In, class F>
+class typed_pipeline_stage : public pipeline_stage
+{
+public:
+	using result_t = std::invoke_result_t<F&, In&&>;
+
+	explicit typed_pipeline_stage(F func) : func_(std::move(func)) {}
+
+	bool process(movable_any& in, movable_any& out) override
+	{
+		if constexpr (std::is_same_v<In, movable_any>)
+		{
+			emit(std::move(in), out);
+		}
+		else
+		{
+			In* value = in.try_get_value<In>();
+			if (value == nullptr)
+			{
+				return false;
+			}
+			emit(std::move(*value), out);
+		}
+		return true;
+	}
+
+private:
+	void emit(In&& value, movable_any& out)
+	{
+		if constexpr (std::is_void_v<result_t>)
+		{
+			func_(std::move(value));
+		}
+		else if constexpr (std::is_same_v<result_t, movable_any>)
+		{
+			out = func_(std::move(value));
+		}
+		else if constexpr (is_optional<result_t>::value)
+		{
+			if (auto result = func_(std::move(value)))
+			{
+				out.emplace<typename result_t::value_type>(std::move(*result));
+			}
+		}
+		else
+		{
+			out.emplace<result_t>(func_(std::move(value)));
+		}
+	}
+
+	F func_;
+};
+
+// Adapts a callable on movable_any whose accepted type is declared at runtime. Items of any
+// other type are rejected as mismatches; get_type_info<movable_any>() accepts everything.
+template <class F>
+class erased_pipeline_stage : public pipeline_stage
+{
+public:
+	explicit erased_pipeline_stage(F func) : func_(std::move(func)) {}
+
+	bool process(movable_any& in, movable_any& out) override
+	{
+		if (input_type != really::get_type_info<movable_any>() && in.type() != input_type)
+		{
+			return false;
+		}
+		out = func_(std::move(in));
+		return true;
+	}
+
+private:
+	F func_;
+};
+
+// The type a stage produces, unwrapping std::optional filters.
+template <class Result>
+using stage_output_t = typename stage_output<Result>::type;
+
+// Runtime state shared by all typed pipeline front ends.
+class pipeline_core
+{
+public:
+	pipeline_core(pipeline_options options) : options_(options)
+	{
+		buffers_.push_back(std::make_unique<any_buffer>(options_.buffer_capacity));
+	}
+
+	// Closes every buffer, not just the input, so workers blocked pushing into output nobody
+	// will drain return instead of holding up the join.
+	~pipeline_core()
+	{
+		for (std::unique_ptr<any_buffer>& buffer : buffers_)
+		{
+			buffer->close();
+		}
+		join();
+	}
+
+	void add_stage(std::unique_ptr<pipeline_stage> stage)
+	{
+		if (stage->options.parallelism == 0)
+		{
+			stage->options.parallelism = 1;
+		}
+		if (stage->options.name.empty())
+		{
+			stage->options.name = "stage" + std::to_string(stages_.size());
+		}
+		stages_.push_back(std::make_unique<stage_state>());
+		stages_.back()->stage = std::move(stage);
+		buffers_.push_back(std::make_unique<any_buffer>(options_.buffer_capacity));
+	}
+
+	void start()
+	{
+		assert(workers_.empty());
+		start_time_ = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < stages_.size(); ++i)
+		{
+			stage_state& state = *stages_[i];
+			state.active_workers = state.stage->options.parallelism;
+			for (size_t w = 0; w < state.stage->options.parallelism; ++w)
+			{
+				workers_.emplace_back([this, i] { run_worker(i); });
+			}
+		}
+	}
+
+	bool push(movable_any* items, size_t count) { return buffers_.front()->push(items, count); }
+
+	size_t pop(movable_any* out, size_t max)
+	{
+		uint64_t ticket;
+		return buffers_.back()->pop(out, max, &ticket);
+	}
+
+	void close() { buffers_.front()->close(); }
+
+	void wait()
+	{
+		close();
+		join();
+	}
+
+	std::vector<stage_stats> stats() const
+	{
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+													   start_time_)
+							 .count();
+
+		std::vector<stage_stats> result;
+		result.reserve(stages_.size());
+		for (size_t i = 0; i < stages_.size(); ++i)
+		{
+			const stage_state& state = *stages_[i];
+			stage_stats& s = result.emplace_back();
+			s.name = state.stage->options.name;
+			s.input_type = state.stage->input_type;
+			s.output_type = state.stage->output_type;
+			s.items_in = state.items_in.load(std::memory_order_relaxed);
+			s.items_out = state.items_out.load(std::memory_order_relaxed);
+			s.type_mismatches = state.type_mismatches.load(std::memory_order_relaxed);
+			s.batches = state.batches.load(std::memory_order_relaxed);
+			s.busy_seconds = state.busy_ns.load(std::memory_order_relaxed) * 1e-9;
+			s.items_per_second = elapsed > 0 ? s.items_out / elapsed : 0;
+			s.queue_depth = buffers_[i]->depth();
+			s.max_queue_depth = buffers_[i]->max_depth();
+		}
+		return result;
+	}
+
+private:
+	void join()
+	{
+		for (std::thread& worker : workers_)
+		{
+			worker.join();
+		}
+		workers_.clear();
+	}
+
+	struct stage_state
+	{
+		std::unique_ptr<pipeline_stage> stage;
+
+		// Ordered stages hand batches downstream strictly by ticket.
+		std::mutex order_mutex;
+		std::condition_variable order_cv;
+		uint64_t next_ticket = 0;
+
+		std::atomic<size_t> active_workers = 0;
+		std::atomic<uint64_t> items_in = 0;
+		std::atomic<uint64_t> items_out = 0;
+		std::atomic<uint64_t> type_mismatches = 0;
+		std::atomic<uint64_t> batches = 0;
+		std::atomic<uint64_t> busy_ns = 0;
+	};
+
+	void run_worker(size_t index)
+	{
+		stage_state& state = *stages_[index];
+		any_buffer& input = *buffers_[index];
+		any_buffer& output = *buffers_[index + 1];
+		const bool ordered = state.stage->options.ordered && state.stage->options.parallelism > 1;
+
+		std::vector<movable_any> in(options_.batch_size == 0 ? 1 : options_.batch_size);
+		std::vector<movable_any> out(in.size());
+		uint64_t ticket = 0;
+		while (size_t n = input.pop(in.data(), in.size(), &ticket))
+		{
+			auto begin = std::chrono::steady_clock::now();
+
+			size_t produced = 0;
+			uint64_t mismatches = 0;
+			for (size_t i = 0; i < n; ++i)
+			{
+				if (!state.stage->process(in[i], out[produced]))
+				{
+					++mismatches;
+				}
+				else if (out[produced].has_value())
+				{
+					++produced;
+				}
+				in[i].reset();
+			}
+
+			state.busy_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+										std::chrono::steady_clock::now() - begin)
+										.count(),
+									std::memory_order_relaxed);
+			state.items_in.fetch_add(n, std::memory_order_relaxed);
+			state.items_out.fetch_add(produced, std::memory_order_relaxed);
+			state.type_mismatches.fetch_add(mismatches, std::memory_order_relaxed);
+			state.batches.fetch_add(1, std::memory_order_relaxed);
+
+			if (ordered)
+			{
+				std::unique_lock lock(state.order_mutex);
+				state.order_cv.wait(lock, [&] { return state.next_ticket == ticket; });
+				output.push(out.data(), produced);
+				++state.next_ticket;
+				state.order_cv.notify_all();
+			}
+			else
+			{
+				output.push(out.data(), produced);
+			}
+		}
+
+		// The last worker out closes the downstream buffer so the next stage can drain.
+		if (state.active_workers.fetch_sub(1) == 1)
+		{
+			output.close();
+		}
+	}
+
+	pipeline_options options_;
+	std::vector<std::unique_ptr<stage_state>> stages_;
+	// buffers_[i] feeds stages_[i]; the last buffer holds the pipeline's output.
+	std::vector<std::unique_ptr<any_buffer>> buffers_;
+	std::vector<std::thread> workers_;
+	std::chrono::steady_clock::time_point start_time_;
+};
+} // namespace detail
+
+// A running pipeline accepting In and producing Out. Out is movable_any when the last stage's
+// output type is only known at runtime, and void when the last stage is a sink.
+template <class In, class Out>
+class pipeline
+{
+public:
+	pipeline(std::unique_ptr<detail::pipeline_core> core, std::string error)
+		: core_(std::move(core)), error_(std::move(error))
+	{
+		if (valid())
+		{
+			core_->start();
+		}
+	}
+
+	// False if stage connections failed their runtime type checks. Invalid pipelines do not
+	// run.
+	bool valid() const { return error_.empty(); }
+	const std::string& error() const { return error_; }
+
+	// Feeds a value to the first stage, blocking while its buffer is full.
+	bool push(In value)
+	{
+		movable_any item;
+		item.emplace<In>(std::move(value));
+		return push(&item, 1);
+	}
+
+	// Feeds a batch of already type-erased values, relocating them into the pipeline.
+	bool push(movable_any* items, size_t count) { return valid() && core_->push(items, count); }
+
+	// Signals that no more input is coming. Stages drain and shut down in order.
+	void close() { core_->close(); }
+
+	// Blocks for the next output value. Returns nullopt once the pipeline is closed and
+	// drained.
+	std::optional<Out> pop()
+		requires(!std::is_void_v<Out>)
+	{
+		movable_any item;
+		while (valid() && core_->pop(&item, 1) > 0)
+		{
+			if constexpr (std::is_same_v<Out, movable_any>)
+			{
+				return item;
+			}
+			else if (Out* value = item.try_get_value<Out>())
+			{
+				return std::move(*value);
+			}
+		}
+		return std::nullopt;
+	}
+
+	// Moves up to max output values into out, blocking until at least one is ready.
+	size_t pop(movable_any* out, size_t max)
+		requires(!std::is_void_v<Out>)
+	{
+		return valid() ? core_->pop(out, max) : 0;
+	}
+
+	// Closes the input and waits for every stage to finish. Output must be drained with pop()
+	// concurrently unless the last stage is a sink.
+	void wait() { core_->wait(); }
+
+	std::vector<stage_stats> stats() const { return core_->stats(); }
+
+private:
+	std::unique_ptr<detail::pipeline_core> core_;
+	std::string error_;
+};
+
+// Builds a pipeline one stage at a time. Out is the static output type of the last stage
+// added, or movable_any when it is only known at runtime.
+template <class In, class Out = In>
+class pipeline_builder
+{
+public:
+	explicit pipeline_builder(pipeline_options options = {})
+		: core_(std::make_unique<detail::pipeline_core>(options)),
+		  runtime_output_(really::get_type_info<Out>())
+	{
+	}
+
+	// Appends a stage. StageIn defaults to the previous stage's output type. When both are
+	// known statically the connection is checked at compile time; when the previous output
+	// is a movable_any, items are checked against StageIn as they arrive and mismatches are
+	// counted and dropped.
+	template <class StageIn = Out, class F>
+	auto then(F func, stage_options options = {}) &&
+	{
+		static_assert(!std::is_void_v<Out>, "cannot add a stage after a sink");
+		static_assert(std::is_same_v<Out, movable_any> || std::is_same_v<StageIn, movable_any> ||
+						  std::is_same_v<StageIn, Out>,
+					  "stage input type does not match the previous stage's output type");
+		static_assert(std::is_invocable_v<F&, StageIn&&>,
+					  "stage callable cannot be invoked with the stage input type");
+
+		using stage_t = detail::typed_pipeline_stage<StageIn, F>;
+		using next_out_t = detail::stage_output_t<typename stage_t::result_t>;
+
+		auto stage = std::make_unique<stage_t>(std::move(func));
+		stage->options = std::move(options);
+		stage->input_type = really::get_type_info<StageIn>();
+		stage->output_type = really::get_type_info<next_out_t>();
+		check_connection(stage->input_type, stage->options.name);
+
+		type_info output = stage->output_type;
+		core_->add_stage(std::move(stage));
+		return pipeline_builder<In, next_out_t>(std::move(core_), std::move(error_), output);
+	}
+
+	// Appends a stage whose types are only known at runtime, such as one loaded from a
+	// plugin. Declared types are checked against their neighbours when the pipeline is
+	// built, and items against the input type as they arrive, counting mismatches;
+	// get_type_info<movable_any>() declares a stage that accepts or produces anything.
+	template <class F>
+		requires std::is_invocable_r_v<movable_any, F&, movable_any&&>
+	auto then_erased(type_info input_type, type_info output_type, F func,
+					 stage_options options = {}) &&
+	{
+		static_assert(!std::is_void_v<Out>, "cannot add a stage after a sink");
+
+		using stage_t = detail::erased_pipeline_stage<F>;
+		auto stage = std::make_unique<stage_t>(std::move(func));
+		stage->options = std::move(options);
+		stage->input_type = input_type;
+		stage->output_type = output_type;
+		check_connection(input_type, stage->options.name);
+
+		core_->add_stage(std::move(stage));
+		return pipeline_builder<In, movable_any>(std::move(core_), std::move(error_),
+												 output_type);
+	}
+
+	pipeline<In, Out> build() && { return pipeline<In, Out>(std::move(core_), std::move(error_)); }
+
+private:
+	template <class, class>
+	friend class pipeline_builder;
+
+	pipeline_builder(std::unique_ptr<detail::pipeline_core> core, std::string error,
+					 type_info runtime_output)
+		: core_(std::move(core)), error_(std::move(error)), runtime_output_(runtime_output)
+	{
+	}
+
+	void check_connection(type_info input, const std::string& name)
+	{
+		const type_info dynamic = really::get_type_info<movable_any>();
+		if (error_.empty() && input != dynamic && runtime_output_ != dynamic &&
+			input != runtime_output_)
+		{
+			error_ = "stage '" + name + "' expects " + std::string(input.name()) +
+					 " but receives " + std::string(runtime_output_.name());
+		}
+	}
+
+	std::unique_ptr<detail::pipeline_core> core_;
+	std::string error_;
+	type_info runtime_output_;
+};
+
+template <class In>
+pipeline_builder<In> make_pipeline(pipeline_options options = {})
+{
+	return pipeline_builder<In>(options);
+}
+
+} // namespace really
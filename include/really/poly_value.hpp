@@ -0,0 +1,204 @@
+#pragma once
+
+#include "really/any.hpp"
+
+#include <algorithm>
+
+
+namespace really
+{
+// An owning, copyable value of any class derived from Base, similar to the proposed
+// std::polymorphic.
+//
+// Derived objects that fit in Size bytes are stored inline, larger ones on the heap. Copies
+// are deep copies made through the stored type's copy operation, so hierarchies need no
+// clone() boilerplate. The Base pointer is cached, so operator-> is a plain load.
+template <class Base, size_t Size = 3 * sizeof(void*) - 1>
+class poly_value
+{
+public:
+	poly_value() = default;
+
+	template <class Derived>
+		requires(!std::is_same_v<std::remove_cvref_t<Derived>, poly_value> &&
+				 std::is_base_of_v<Base, std::remove_cvref_t<Derived>>)
+	poly_value(Derived&& value)
+	{
+		emplace<std::remove_cvref_t<Derived>>(std::forward<Derived>(value));
+	}
+
+	poly_value(const poly_value& other) { copy_from(other); }
+
+	poly_value(poly_value&& other) noexcept { move_from(other); }
+
+	poly_value& operator=(const poly_value& other)
+	{
+		if (this != &other)
+		{
+			reset();
+			copy_from(other);
+		}
+		return *this;
+	}
+
+	poly_value& operator=(poly_value&& other) noexcept
+	{
+		if (this != &other)
+		{
+			reset();
+			move_from(other);
+		}
+		return *this;
+	}
+
+	~poly_value() { reset(); }
+
+	template <class Derived, class... Args>
+	Derived& emplace(Args&&... args)
+	{
+		static_assert(std::is_base_of_v<Base, Derived>,
+					  "poly_value holds classes derived from Base");
+		static_assert(std::is_copy_constructible_v<Derived>, "poly_value must be copyable");
+
+		reset();
+		const any_type_operations& ops = get_type_operations<Derived>();
+		storage_.allocate(storage_size(ops));
+		free_on_unwind guard{this};
+		Derived* value = ::new (storage_.get_storage()) Derived(std::forward<Args>(args)...);
+		guard.self = nullptr;
+		ops_ = &ops;
+		ptr_ = value;
+		return *value;
+	}
+
+	void reset()
+	{
+		if (ops_ != nullptr)
+		{
+			ops_->destruct(storage_.get_storage());
+			storage_.free();
+			ops_ = nullptr;
+			ptr_ = nullptr;
+		}
+	}
+
+	bool has_value() const { return ptr_ != nullptr; }
+	explicit operator bool() const { return has_value(); }
+
+	Base* get() { return ptr_; }
+	const Base* get() const { return ptr_; }
+
+	Base* operator->()
+	{
+		assert(has_value());
+		return ptr_;
+	}
+
+	const Base* operator->() const
+	{
+		assert(has_value());
+		return ptr_;
+	}
+
+	Base& operator*() { return *operator->(); }
+	const Base& operator*() const { return *operator->(); }
+
+	// The dynamic type of the held object, or void if empty.
+	type_info type() const
+	{
+		return ops_ != nullptr ? ops_->get_type_info() : really::get_type_info<void>();
+	}
+
+	// Returns the held object if its dynamic type is exactly Derived.
+	template <class Derived>
+	Derived* try_get()
+	{
+		return type() == really::get_type_info<Derived>()
+				   ? static_cast<Derived*>(storage_.get_storage())
+				   : nullptr;
+	}
+
+	template <class Derived>
+	const Derived* try_get() const
+	{
+		return const_cast<poly_value*>(this)->template try_get<Derived>();
+	}
+
+private:
+	using storage_t = detail::any_small_buffer_storage<Size>;
+
+	// Gives the storage back if constructing the object throws, leaving the value empty.
+	struct free_on_unwind
+	{
+		poly_value* self;
+
+		~free_on_unwind()
+		{
+			if (self != nullptr)
+			{
+				self->storage_.free();
+			}
+		}
+	};
+
+	// The inline buffer is only pointer-aligned, so over-aligned types always go to the heap.
+	static size_t storage_size(const any_type_operations& ops)
+	{
+		return ops.alignment() > alignof(void*) ? std::max(ops.size(), sizeof(storage_t))
+												: ops.size();
+	}
+
+	// The base subobject sits at a fixed offset from the start of the stored object, so the
+	// cached pointer is rebased whenever the object moves to new storage.
+	Base* rebase(const poly_value& other)
+	{
+		auto offset = reinterpret_cast<const char*>(other.ptr_) -
+					  static_cast<const char*>(other.storage_.get_storage());
+		return reinterpret_cast<Base*>(static_cast<char*>(storage_.get_storage()) + offset);
+	}
+
+	void copy_from(const poly_value& other)
+	{
+		if (other.ops_ == nullptr)
+		{
+			return;
+		}
+		storage_.allocate(storage_size(*other.ops_));
+		free_on_unwind guard{this};
+		other.ops_->copy(storage_.get_storage(), other.storage_.get_storage());
+		guard.self = nullptr;
+		ops_ = other.ops_;
+		ptr_ = rebase(other);
+	}
+
+	void move_from(poly_value& other)
+	{
+		if (other.ops_ == nullptr)
+		{
+			return;
+		}
+
+		// Heap objects change hands by pointer; inline ones are moved through their ops.
+		if (storage_.try_swap(&other.storage_))
+		{
+			ptr_ = other.ptr_;
+		}
+		else
+		{
+			storage_.allocate(storage_size(*other.ops_));
+			other.ops_->move(storage_.get_storage(), other.storage_.get_storage());
+			ptr_ = rebase(other);
+			other.ops_->destruct(other.storage_.get_storage());
+			other.storage_.free();
+		}
+		ops_ = other.ops_;
+		other.ops_ = nullptr;
+		other.ptr_ = nullptr;
+	}
+
+	storage_t storage_;
+	const any_type_operations* ops_ = nullptr;
+	Base* ptr_ = nullptr;
+};
+
+} // namespace really
@@ -0,0 +1,257 @@
+#pragma once
+
+#include "really/any.hpp"
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+
+namespace really
+{
+namespace detail
+{
+template <class T>
+concept adl_recyclable = requires(T& value) { recycle(value); };
+
+template <adl_recyclable T>
+void adl_recycle(T& value)
+{
+	recycle(value);
+}
+} // namespace detail
+
+// Customizes how a pooled object is cleared before it is handed out again. The default calls
+// recycle(value) found by argument-dependent lookup if there is one, and otherwise leaves the
+// object untouched. Specialize this for types whose namespace you do not own, such as
+// std::vector<char>.
+template <class T>
+struct recycle_traits
+{
+	static void recycle(T& value)
+	{
+		if constexpr (detail::adl_recyclable<T>)
+		{
+			detail::adl_recycle(value);
+		}
+	}
+};
+
+// Keeps released objects alive so that later acquires reuse them instead of constructing
+// fresh ones. Expensive-to-build payloads (buffers with reserved capacity, parsers with warm
+// tables) come back with their resources intact; heap payloads change hands by pointer swap,
+// so a warm acquire does no allocation either.
+//
+// Objects are grouped by really::type_info, and each group has its own cap. Every thread also
+// keeps a small front cache per pool and type that it checks before taking the pool lock;
+// objects in front caches are not counted against the cap.
+template <any_any Any = any<>>
+class recycling_pool
+{
+public:
+	explicit recycling_pool(size_t default_capacity = 64, size_t thread_cache_size = 8)
+		: default_capacity_(default_capacity), thread_cache_size_(thread_cache_size)
+	{
+	}
+
+	recycling_pool(const recycling_pool&) = delete;
+	recycling_pool& operator=(const recycling_pool&) = delete;
+
+	// Sets how many released objects of type T the shared pool keeps.
+	template <class T>
+	void set_capacity(size_t capacity)
+	{
+		std::lock_guard lock(mutex_);
+		shard& s = shards_[really::get_type_info<T>()];
+		s.capacity = capacity;
+		trim(s);
+	}
+
+	// Returns an object to the pool. Returns false, destroying the value, if it is empty or
+	// its type's group is already full.
+	bool release(Any&& value)
+	{
+		if (!value.has_value())
+		{
+			return false;
+		}
+
+		if (std::vector<Any>* local = local_cache(value.type()))
+		{
+			if (local->size() < thread_cache_size_)
+			{
+				local->push_back(std::move(value));
+				return true;
+			}
+		}
+		return release_shared(std::move(value));
+	}
+
+	// Hands out a pooled T, cleared through recycle_traits<T>, or a freshly emplaced one
+	// constructed from args if none is available.
+	template <class T, class... Args>
+	Any acquire(Args&&... args)
+	{
+		using value_t = std::decay_t<T>;
+		Any result;
+		if (take(really::get_type_info<value_t>(), result))
+		{
+			recycle_traits<value_t>::recycle(result.template value<value_t>());
+		}
+		else
+		{
+			result.template emplace<value_t>(std::forward<Args>(args)...);
+		}
+		return result;
+	}
+
+	// Number of T objects in the shared pool, not counting thread caches.
+	template <class T>
+	size_t available() const
+	{
+		std::lock_guard lock(mutex_);
+		auto it = shards_.find(really::get_type_info<T>());
+		return it != shards_.end() ? it->second.items.size() : 0;
+	}
+
+	// Moves this thread's cached objects back to the shared pool, destroying any that exceed
+	// their group's cap.
+	void flush_thread_cache()
+	{
+		for (cache_entry& entry : thread_cache().entries)
+		{
+			if (entry.pool == this && !entry.alive.expired())
+			{
+				std::vector<Any> items = std::move(entry.items);
+				entry.items.clear();
+				for (Any& item : items)
+				{
+					release_shared(std::move(item));
+				}
+			}
+		}
+	}
+
+	// Destroys every pooled object in the shared pool.
+	void clear()
+	{
+		std::lock_guard lock(mutex_);
+		for (auto& [type, s] : shards_)
+		{
+			s.items.clear();
+		}
+	}
+
+private:
+	struct shard
+	{
+		std::vector<Any> items;
+		size_t capacity = 0;
+	};
+
+	struct cache_entry
+	{
+		const recycling_pool* pool;
+		std::weak_ptr<void> alive;
+		type_info type;
+		std::vector<Any> items;
+	};
+
+	struct cache
+	{
+		std::vector<cache_entry> entries;
+	};
+
+	static cache& thread_cache()
+	{
+		thread_local cache c;
+		return c;
+	}
+
+	// Finds or creates this thread's front cache for the given type, dropping entries that
+	// belong to pools which no longer exist.
+	std::vector<Any>* local_cache(type_info type)
+	{
+		if (thread_cache_size_ == 0)
+		{
+			return nullptr;
+		}
+
+		std::vector<cache_entry>& entries = thread_cache().entries;
+		for (size_t i = 0; i < entries.size();)
+		{
+			cache_entry& entry = entries[i];
+			if (entry.alive.expired())
+			{
+				entry = std::move(entries.back());
+				entries.pop_back();
+				continue;
+			}
+			if (entry.pool == this && entry.type == type)
+			{
+				return &entry.items;
+			}
+			++i;
+		}
+
+		entries.push_back({this, alive_, type, {}});
+		entries.back().items.reserve(thread_cache_size_);
+		return &entries.back().items;
+	}
+
+	bool take(type_info type, Any& result)
+	{
+		if (std::vector<Any>* local = local_cache(type); local != nullptr && !local->empty())
+		{
+			result = std::move(local->back());
+			local->pop_back();
+			return true;
+		}
+
+		std::lock_guard lock(mutex_);
+		auto it = shards_.find(type);
+		if (it == shards_.end() || it->second.items.empty())
+		{
+			return false;
+		}
+		result = std::move(it->second.items.back());
+		it->second.items.pop_back();
+		return true;
+	}
+
+	bool release_shared(Any&& value)
+	{
+		std::lock_guard lock(mutex_);
+		auto [it, inserted] = shards_.try_emplace(value.type());
+		shard& s = it->second;
+		if (inserted)
+		{
+			s.capacity = default_capacity_;
+		}
+		if (s.items.size() >= s.capacity)
+		{
+			value.reset();
+			return false;
+		}
+		s.items.push_back(std::move(value));
+		return true;
+	}
+
+	static void trim(shard& s)
+	{
+		if (s.items.size() > s.capacity)
+		{
+			s.items.erase(s.items.begin() + s.capacity, s.items.end());
+		}
+	}
+
+	mutable std::mutex mutex_;
+	std::unordered_map<type_info, shard> shards_;
+	size_t default_capacity_;
+	size_t thread_cache_size_;
+	// Thread caches hold a weak reference so they can tell when this pool is gone.
+	std::shared_ptr<void> alive_ = std::make_shared<char>();
+};
+
+} // namespace really
@@ -0,0 +1,576 @@
+#pragma once
+
+#include "really/any.hpp"
+
+#include <compare>
+#include <cstring>
+#include <functional>
+#include <span>
+#include <string>
+#include <tuple>
+#include <vector>
+
+
+// Compile-time reflection of aggregates, and the value operations it synthesizes.
+//
+// Plain structs get hashing, equality, ordering and binary serialization without per-type
+// boilerplate: the field count is detected by brace-initialization and the fields are reached
+// through structured bindings. Trivially copyable aggregates without padding take memcpy
+// fast paths. Opting a type in with enable_aggregate_ops plugs the operations into the ops
+// table every any holding it uses.
+namespace really
+{
+// Specialize as true to expose an aggregate's synthesized operations through the any ops
+// table. The specialization and this header must be visible wherever the type is stored.
+template <class T>
+inline constexpr bool enable_aggregate_ops = false;
+
+namespace reflect_impl
+{
+// Converts to anything, for probing how many initializers an aggregate accepts.
+struct any_initializer
+{
+	template <class T>
+	constexpr operator T() const noexcept;
+};
+
+constexpr size_t max_fields = 16;
+
+template <class T, size_t... I>
+constexpr bool brace_constructible(std::index_sequence<I...>)
+{
+	return requires { T{(void(I), any_initializer{})...}; };
+}
+
+template <class T, size_t N = 0>
+consteval size_t count_fields()
+{
+	if constexpr (N < max_fields && brace_constructible<T>(std::make_index_sequence<N + 1>()))
+	{
+		return count_fields<T, N + 1>();
+	}
+	else
+	{
+		return N;
+	}
+}
+} // namespace reflect_impl
+
+// Plain aggregates with at most 16 direct fields. Members that are C arrays or rely on brace
+// elision are not supported.
+template <class T>
+concept reflectable_aggregate = std::is_aggregate_v<T> && !std::is_array_v<T> &&
+								std::is_default_constructible_v<T> &&
+								reflect_impl::count_fields<T>() > 0;
+
+template <reflectable_aggregate T>
+constexpr size_t field_count = reflect_impl::count_fields<T>();
+
+// Returns a tuple of references to the fields of an aggregate.
+template <class T>
+	requires reflectable_aggregate<std::remove_const_t<T>>
+constexpr auto tie_fields(T& value)
+{
+	constexpr size_t N = field_count<std::remove_const_t<T>>;
+	if constexpr (N == 1)
+	{
+		auto& [a] = value;
+		return std::tie(a);
+	}
+	else if constexpr (N == 2)
+	{
+		auto& [a, b] = value;
+		return std::tie(a, b);
+	}
+	else if constexpr (N == 3)
+	{
+		auto& [a, b, c] = value;
+		return std::tie(a, b, c);
+	}
+	else if constexpr (N == 4)
+	{
+		auto& [a, b, c, d] = value;
+		return std::tie(a, b, c, d);
+	}
+	else if constexpr (N == 5)
+	{
+		auto& [a, b, c, d, e] = value;
+		return std::tie(a, b, c, d, e);
+	}
+	else if constexpr (N == 6)
+	{
+		auto& [a, b, c, d, e, f] = value;
+		return std::tie(a, b, c, d, e, f);
+	}
+	else if constexpr (N == 7)
+	{
+		auto& [a, b, c, d, e, f, g] = value;
+		return std::tie(a, b, c, d, e, f, g);
+	}
+	else if constexpr (N == 8)
+	{
+		auto& [a, b, c, d, e, f, g, h] = value;
+		return std::tie(a, b, c, d, e, f, g, h);
+	}
+	else if constexpr (N == 9)
+	{
+		auto& [a, b, c, d, e, f, g, h, i] = value;
+		return std::tie(a, b, c, d, e, f, g, h, i);
+	}
+	else if constexpr (N == 10)
+	{
+		auto& [a, b, c, d, e, f, g, h, i, j] = value;
+		return std::tie(a, b, c, d, e, f, g, h, i, j);
+	}
+	else if constexpr (N == 11)
+	{
+		auto& [a, b, c, d, e, f, g, h, i, j, k] = value;
+		return std::tie(a, b, c, d, e, f, g, h, i, j, k);
+	}
+	else if constexpr (N == 12)
+	{
+		auto& [a, b, c, d, e, f, g, h, i, j, k, l] = value;
+		return std::tie(a, b, c, d, e, f, g, h, i, j, k, l);
+	}
+	else if constexpr (N == 13)
+	{
+		auto& [a, b, c, d, e, f, g, h, i, j, k, l, m] = value;
+		return std::tie(a, b, c, d, e, f, g, h, i, j, k, l, m);
+	}
+	else if constexpr (N == 14)
+	{
+		auto& [a, b, c, d, e, f, g, h, i, j, k, l, m, n] = value;
+		return std::tie(a, b, c, d, e, f, g, h, i, j, k, l, m, n);
+	}
+	else if constexpr (N == 15)
+	{
+		auto& [a, b, c, d, e, f, g, h, i, j, k, l, m, n, o] = value;
+		return std::tie(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o);
+	}
+	else if constexpr (N == 16)
+	{
+		auto& [a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p] = value;
+		return std::tie(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p);
+	}
+}
+
+template <reflectable_aggregate T>
+using field_types = decltype(tie_fields(std::declval<T&>()));
+
+namespace reflect_impl
+{
+// Whether every byte of T is part of a value: scalars, and arrays and aggregates built from
+// them with no padding at any level of nesting.
+template <class T>
+constexpr bool padding_free()
+{
+	if constexpr (std::is_scalar_v<T>)
+	{
+		return true;
+	}
+	else if constexpr (std::is_array_v<T>)
+	{
+		return padding_free<std::remove_extent_t<T>>();
+	}
+	else if constexpr (reflectable_aggregate<T>)
+	{
+		return []<size_t... I>(std::index_sequence<I...>) {
+			return (size_t(0) + ... +
+					sizeof(std::remove_reference_t<std::tuple_element_t<I, field_types<T>>>)) ==
+					   sizeof(T) &&
+				   (padding_free<
+						std::remove_reference_t<std::tuple_element_t<I, field_types<T>>>>() &&
+					...);
+		}(std::make_index_sequence<field_count<T>>());
+	}
+	else
+	{
+		return std::has_unique_object_representations_v<T>;
+	}
+}
+
+// Aggregates that can be hashed, compared and serialized as raw bytes.
+template <class T>
+constexpr bool bytewise_comparable = std::has_unique_object_representations_v<T>;
+
+template <class T>
+constexpr bool bytewise_serializable = std::is_trivially_copyable_v<T> && padding_free<T>();
+
+template <class T>
+struct is_vector : std::false_type
+{
+};
+
+template <class T, class Alloc>
+struct is_vector<std::vector<T, Alloc>> : std::true_type
+{
+};
+
+inline size_t hash_combine(size_t seed, size_t value)
+{
+	return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+inline size_t hash_bytes(const void* data, size_t size)
+{
+	return std::hash<std::string_view>{}(std::string_view(static_cast<const char*>(data), size));
+}
+
+struct byte_writer
+{
+	value_operations::write_fn write;
+	void* context;
+
+	void operator()(const void* data, size_t size) const { write(context, data, size); }
+};
+
+inline void append_bytes(void* context, const void* data, size_t size)
+{
+	auto& bytes = *static_cast<std::vector<std::byte>*>(context);
+	auto* begin = static_cast<const std::byte*>(data);
+	bytes.insert(bytes.end(), begin, begin + size);
+}
+
+struct byte_reader
+{
+	const unsigned char*& in;
+	const unsigned char* end;
+
+	bool operator()(void* data, size_t size) const
+	{
+		if (static_cast<size_t>(end - in) < size)
+		{
+			return false;
+		}
+		std::memcpy(data, in, size);
+		in += size;
+		return true;
+	}
+};
+} // namespace reflect_impl
+
+template <class T>
+size_t aggregate_hash(const T& value);
+
+template <class T>
+bool aggregate_equal(const T& lhs, const T& rhs);
+
+template <class T>
+int aggregate_compare(const T& lhs, const T& rhs);
+
+template <class T>
+void aggregate_serialize(const T& value, reflect_impl::byte_writer write);
+
+template <class T>
+bool aggregate_deserialize(T& value, reflect_impl::byte_reader read);
+
+namespace reflect_impl
+{
+template <class F>
+size_t hash_field(const F& field)
+{
+	if constexpr (reflectable_aggregate<F>)
+	{
+		return aggregate_hash(field);
+	}
+	else if constexpr (is_vector<F>::value)
+	{
+		size_t h = field.size();
+		for (const auto& element : field)
+		{
+			h = hash_combine(h, hash_field(element));
+		}
+		return h;
+	}
+	else
+	{
+		return std::hash<F>{}(field);
+	}
+}
+
+template <class F>
+bool equal_field(const F& lhs, const F& rhs)
+{
+	if constexpr (reflectable_aggregate<F> && !std::equality_comparable<F>)
+	{
+		return aggregate_equal(lhs, rhs);
+	}
+	else
+	{
+		return lhs == rhs;
+	}
+}
+
+template <class F>
+int compare_field(const F& lhs, const F& rhs)
+{
+	if constexpr (reflectable_aggregate<F> && !std::three_way_comparable<F>)
+	{
+		return aggregate_compare(lhs, rhs);
+	}
+	else
+	{
+		auto order = lhs <=> rhs;
+		return order < 0 ? -1 : order > 0 ? 1 : 0;
+	}
+}
+
+template <class F>
+void serialize_field(const F& field, byte_writer write)
+{
+	if constexpr (std::is_arithmetic_v<F> || std::is_enum_v<F>)
+	{
+		write(&field, sizeof(F));
+	}
+	else if constexpr (std::is_same_v<F, std::string>)
+	{
+		uint64_t size = field.size();
+		write(&size, sizeof(size));
+		write(field.data(), field.size());
+	}
+	else if constexpr (is_vector<F>::value)
+	{
+		uint64_t size = field.size();
+		write(&size, sizeof(size));
+		for (const auto& element : field)
+		{
+			serialize_field(element, write);
+		}
+	}
+	else
+	{
+		static_assert(reflectable_aggregate<F>, "field type cannot be serialized");
+		aggregate_serialize(field, write);
+	}
+}
+
+template <class F>
+bool deserialize_field(F& field, byte_reader read)
+{
+	if constexpr (std::is_arithmetic_v<F> || std::is_enum_v<F>)
+	{
+		return read(&field, sizeof(F));
+	}
+	else if constexpr (std::is_same_v<F, std::string>)
+	{
+		uint64_t size;
+		if (!read(&size, sizeof(size)) || static_cast<uint64_t>(read.end - read.in) < size)
+		{
+			return false;
+		}
+		field.assign(reinterpret_cast<const char*>(read.in), size);
+		read.in += size;
+		return true;
+	}
+	else if constexpr (is_vector<F>::value)
+	{
+		uint64_t size;
+		if (!read(&size, sizeof(size)))
+		{
+			return false;
+		}
+		field.clear();
+		for (uint64_t i = 0; i < size; ++i)
+		{
+			if (!deserialize_field(field.emplace_back(), read))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+	else
+	{
+		static_assert(reflectable_aggregate<F>, "field type cannot be deserialized");
+		return aggregate_deserialize(field, read);
+	}
+}
+} // namespace reflect_impl
+
+template <class T>
+size_t aggregate_hash(const T& value)
+{
+	if constexpr (reflect_impl::bytewise_comparable<T>)
+	{
+		return reflect_impl::hash_bytes(&value, sizeof(T));
+	}
+	else
+	{
+		return std::apply(
+			[](const auto&... fields) {
+				size_t h = 0;
+				((h = reflect_impl::hash_combine(h, reflect_impl::hash_field(fields))), ...);
+				return h;
+			},
+			tie_fields(value));
+	}
+}
+
+template <class T>
+bool aggregate_equal(const T& lhs, const T& rhs)
+{
+	if constexpr (reflect_impl::bytewise_comparable<T>)
+	{
+		return std::memcmp(&lhs, &rhs, sizeof(T)) == 0;
+	}
+	else
+	{
+		auto l = tie_fields(lhs);
+		auto r = tie_fields(rhs);
+		return [&]<size_t... I>(std::index_sequence<I...>) {
+			return (reflect_impl::equal_field(std::get<I>(l), std::get<I>(r)) && ...);
+		}(std::make_index_sequence<field_count<T>>());
+	}
+}
+
+// Lexicographic comparison of the fields in declaration order.
+template <class T>
+int aggregate_compare(const T& lhs, const T& rhs)
+{
+	auto l = tie_fields(lhs);
+	auto r = tie_fields(rhs);
+	return [&]<size_t... I>(std::index_sequence<I...>) {
+		int result = 0;
+		((result = result != 0 ? result
+							   : reflect_impl::compare_field(std::get<I>(l), std::get<I>(r))),
+		 ...);
+		return result;
+	}(std::make_index_sequence<field_count<T>>());
+}
+
+template <class T>
+void aggregate_serialize(const T& value, reflect_impl::byte_writer write)
+{
+	if constexpr (reflect_impl::bytewise_serializable<T>)
+	{
+		write(&value, sizeof(T));
+	}
+	else
+	{
+		std::apply(
+			[&](const auto&... fields) { (reflect_impl::serialize_field(fields, write), ...); },
+			tie_fields(value));
+	}
+}
+
+template <class T>
+bool aggregate_deserialize(T& value, reflect_impl::byte_reader read)
+{
+	if constexpr (reflect_impl::bytewise_serializable<T>)
+	{
+		return read(&value, sizeof(T));
+	}
+	else
+	{
+		return std::apply(
+			[&](auto&... fields) { return (reflect_impl::deserialize_field(fields, read) && ...); },
+			tie_fields(value));
+	}
+}
+
+// Appends the binary form of value to out.
+template <reflectable_aggregate T>
+void aggregate_serialize(const T& value, std::vector<std::byte>& out)
+{
+	aggregate_serialize(value, reflect_impl::byte_writer{reflect_impl::append_bytes, &out});
+}
+
+// Reads value from the front of in, advancing past what was consumed.
+template <reflectable_aggregate T>
+bool aggregate_deserialize(T& value, std::span<const std::byte>& in)
+{
+	auto* cursor = reinterpret_cast<const unsigned char*>(in.data());
+	bool ok = aggregate_deserialize(value, reflect_impl::byte_reader{cursor, cursor + in.size()});
+	in = in.subspan(cursor - reinterpret_cast<const unsigned char*>(in.data()));
+	return ok;
+}
+
+// The synthesized operations in the shape the any ops table expects.
+template <reflectable_aggregate T>
+inline constexpr value_operations aggregate_value_operations = {
+	[](const void* value) { return aggregate_hash(*static_cast<const T*>(value)); },
+	[](const void* lhs, const void* rhs) {
+		return aggregate_equal(*static_cast<const T*>(lhs), *static_cast<const T*>(rhs));
+	},
+	[](const void* lhs, const void* rhs) {
+		return aggregate_compare(*static_cast<const T*>(lhs), *static_cast<const T*>(rhs));
+	},
+	[](const void* value, value_operations::write_fn write, void* context) {
+		aggregate_serialize(*static_cast<const T*>(value),
+							reflect_impl::byte_writer{write, context});
+	},
+	[](void* value, const unsigned char*& in, const unsigned char* end) {
+		return aggregate_deserialize(*static_cast<T*>(value), reflect_impl::byte_reader{in, end});
+	},
+};
+
+template <class T>
+	requires(enable_aggregate_ops<T> && reflectable_aggregate<T>)
+struct value_operations_for<T>
+{
+	static constexpr const value_operations* value = &aggregate_value_operations<T>;
+};
+
+// Value operations on anys whose held type provides them. Empty anys and types without
+// value operations hash to 0, compare equal only to an empty any, and do not serialize.
+template <any_any Any>
+size_t any_hash(const Any& value)
+{
+	const any_type_operations* ops = value.operations();
+	const value_operations* vops = ops != nullptr ? ops->value_ops() : nullptr;
+	return vops != nullptr ? vops->hash(value.data()) : 0;
+}
+
+template <any_any Lhs, any_any Rhs>
+bool any_equal(const Lhs& lhs, const Rhs& rhs)
+{
+	if (!lhs.has_value() || !rhs.has_value())
+	{
+		return lhs.has_value() == rhs.has_value();
+	}
+	const value_operations* vops = lhs.operations()->value_ops();
+	return lhs.type() == rhs.type() && vops != nullptr && vops->equal(lhs.data(), rhs.data());
+}
+
+// Orders values of the same type with their compare operation and everything else by type.
+template <any_any Lhs, any_any Rhs>
+int any_compare(const Lhs& lhs, const Rhs& rhs)
+{
+	if (lhs.type() != rhs.type())
+	{
+		return lhs.type().before(rhs.type()) ? -1 : 1;
+	}
+	const value_operations* vops = lhs.has_value() ? lhs.operations()->value_ops() : nullptr;
+	return vops != nullptr ? vops->compare(lhs.data(), rhs.data()) : 0;
+}
+
+template <any_any Any>
+bool any_serialize(const Any& value, std::vector<std::byte>& out)
+{
+	const value_operations* vops = value.has_value() ? value.operations()->value_ops() : nullptr;
+	if (vops == nullptr)
+	{
+		return false;
+	}
+	vops->serialize(value.data(), reflect_impl::append_bytes, &out);
+	return true;
+}
+
+// Overwrites the value currently held with one read from in. The any must already hold a
+// value of the serialized type.
+template <any_any Any>
+bool any_deserialize(Any& value, std::span<const std::byte>& in)
+{
+	const value_operations* vops = value.has_value() ? value.operations()->value_ops() : nullptr;
+	if (vops == nullptr)
+	{
+		return false;
+	}
+	auto* begin = reinterpret_cast<const unsigned char*>(in.data());
+	auto* cursor = begin;
+	bool ok = vops->deserialize(value.data(), cursor, begin + in.size());
+	in = in.subspan(cursor - begin);
+	return ok;
+}
+
+} // namespace really
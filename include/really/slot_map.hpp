@@ -0,0 +1,224 @@
+#pragma once
+
+#include "really/any.hpp"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+
+namespace really
+{
+// A stable reference to a slot_map element. The generation detects use after erase.
+struct slot_handle
+{
+	uint32_t index = UINT32_MAX;
+	uint32_t generation = 0;
+
+	constexpr bool operator==(const slot_handle&) const = default;
+};
+
+// Generational slot map of type-erased values.
+//
+// Values live in a dense array so iteration is contiguous. Handles index a sparse slot array
+// that holds each value's dense position and the slot's current generation, making lookup
+// O(1). Erasing moves the last value into the hole, so erase is O(1) too, but dense positions
+// (and pointers to values) are not stable across erase - only handles are.
+template <any_any Any = any<>>
+class slot_map
+{
+public:
+	using value_type = Any;
+
+	slot_map() = default;
+
+	// The value is built before it is given a slot, so if anything throws the map is left as
+	// it was.
+	template <class T, class... Args>
+	slot_handle emplace(Args&&... args)
+	{
+		values_.emplace_back();
+		unappend_on_unwind guard{this};
+		values_.back().template emplace<T>(std::forward<Args>(args)...);
+		slot_handle handle = allocate_slot();
+		guard.self = nullptr;
+		return handle;
+	}
+
+	slot_handle insert(Any&& value)
+	{
+		values_.push_back(std::move(value));
+		unappend_on_unwind guard{this};
+		slot_handle handle = allocate_slot();
+		guard.self = nullptr;
+		return handle;
+	}
+
+	slot_handle insert(const Any& value)
+		requires(Any::copy_support == any_copy_support::copy_and_move)
+	{
+		values_.push_back(value);
+		unappend_on_unwind guard{this};
+		slot_handle handle = allocate_slot();
+		guard.self = nullptr;
+		return handle;
+	}
+
+	bool contains(slot_handle handle) const { return find(handle) != nullptr; }
+
+	Any* get(slot_handle handle) { return const_cast<Any*>(find(handle)); }
+	const Any* get(slot_handle handle) const { return find(handle); }
+
+	// Returns the value if the handle is live and holds a T, otherwise nullptr.
+	template <class T>
+	std::decay_t<T>* get(slot_handle handle)
+	{
+		Any* value = get(handle);
+		return value != nullptr ? value->template try_get_value<T>() : nullptr;
+	}
+
+	template <class T>
+	const std::decay_t<T>* get(slot_handle handle) const
+	{
+		const Any* value = get(handle);
+		return value != nullptr ? value->template try_get_value<T>() : nullptr;
+	}
+
+	bool erase(slot_handle handle)
+	{
+		if (find(handle) == nullptr)
+		{
+			return false;
+		}
+
+		slot& erased = slots_[handle.index];
+		uint32_t dense = erased.dense_index;
+		uint32_t last = static_cast<uint32_t>(values_.size() - 1);
+		if (dense != last)
+		{
+			values_[dense] = std::move(values_[last]);
+			dense_to_slot_[dense] = dense_to_slot_[last];
+			slots_[dense_to_slot_[dense]].dense_index = dense;
+		}
+		values_.pop_back();
+		dense_to_slot_.pop_back();
+
+		++erased.generation;
+		erased.dense_index = free_head_;
+		free_head_ = handle.index;
+		return true;
+	}
+
+	void clear()
+	{
+		for (uint32_t slot_index : dense_to_slot_)
+		{
+			slot& s = slots_[slot_index];
+			++s.generation;
+			s.dense_index = free_head_;
+			free_head_ = slot_index;
+		}
+		values_.clear();
+		dense_to_slot_.clear();
+	}
+
+	void reserve(size_t count)
+	{
+		values_.reserve(count);
+		dense_to_slot_.reserve(count);
+		slots_.reserve(count);
+	}
+
+	size_t size() const { return values_.size(); }
+	bool empty() const { return values_.empty(); }
+
+	// Dense iteration over all values, in no particular order.
+	auto begin() { return values_.begin(); }
+	auto end() { return values_.end(); }
+	auto begin() const { return values_.begin(); }
+	auto end() const { return values_.end(); }
+
+	std::span<Any> values() { return values_; }
+	std::span<const Any> values() const { return values_; }
+
+	// The handle of the value at a dense position.
+	slot_handle handle_at(size_t dense_index) const
+	{
+		uint32_t index = dense_to_slot_[dense_index];
+		return {index, slots_[index].generation};
+	}
+
+	// Calls f(handle, value) for each value holding a T.
+	template <class T, class F>
+	void for_each(F&& f)
+	{
+		for (size_t i = 0; i < values_.size(); ++i)
+		{
+			if (auto* value = values_[i].template try_get_value<T>())
+			{
+				f(handle_at(i), *value);
+			}
+		}
+	}
+
+private:
+	struct slot
+	{
+		// The value's position in values_ while live, the next free slot otherwise.
+		uint32_t dense_index;
+		uint32_t generation;
+	};
+
+	const Any* find(slot_handle handle) const
+	{
+		if (handle.index >= slots_.size())
+		{
+			return nullptr;
+		}
+		const slot& s = slots_[handle.index];
+		return s.generation == handle.generation ? &values_[s.dense_index] : nullptr;
+	}
+
+	// Drops the value appended last, and its dense entry if it got one, when inserting it
+	// throws before it has a slot.
+	struct unappend_on_unwind
+	{
+		slot_map* self;
+
+		~unappend_on_unwind()
+		{
+			if (self != nullptr)
+			{
+				self->values_.pop_back();
+				self->dense_to_slot_.resize(self->values_.size());
+			}
+		}
+	};
+
+	// Gives the value appended last a slot. The free list is only touched once nothing else
+	// can throw.
+	slot_handle allocate_slot()
+	{
+		uint32_t index =
+			free_head_ != UINT32_MAX ? free_head_ : static_cast<uint32_t>(slots_.size());
+		dense_to_slot_.push_back(index);
+		if (index == slots_.size())
+		{
+			slots_.push_back({0, 0});
+		}
+		else
+		{
+			free_head_ = slots_[index].dense_index;
+		}
+
+		slots_[index].dense_index = static_cast<uint32_t>(values_.size() - 1);
+		return {index, slots_[index].generation};
+	}
+
+	std::vector<Any> values_;
+	std::vector<uint32_t> dense_to_slot_;
+	std::vector<slot> slots_;
+	uint32_t free_head_ = UINT32_MAX;
+};
+
+} // namespace really
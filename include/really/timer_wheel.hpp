@@ -0,0 +1,326 @@
+#pragma once
+
+#include "really/any.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+namespace really
+{
+struct timer_handle
+{
+	void* node = nullptr;
+	uint32_t generation = 0;
+
+	constexpr bool operator==(const timer_handle&) const = default;
+};
+
+// A hierarchical timing wheel.
+//
+// Time is measured in integer ticks. Eight levels of 256 slots cover the full 64-bit range:
+// a timer sits in the level of the highest byte in which its expiry differs from the current
+// tick, and is cascaded to lower levels as time catches up. Scheduling and cancelling are
+// O(1), and a slot's expired timers are detached and run as one batch. Per-level occupancy
+// bitmaps let an advance skip empty ticks, so its cost follows the number of timers rather
+// than the distance advanced.
+//
+// Timer nodes come from an intrusive pool and embed their callback in a small buffer of
+// PayloadSize bytes, so scheduling a small callable allocates nothing.
+template <size_t PayloadSize = 4 * sizeof(void*) - 1>
+class timer_wheel
+{
+public:
+	explicit timer_wheel(uint64_t now = 0) : now_(now)
+	{
+		for (auto& level : wheel_)
+		{
+			for (link& slot : level)
+			{
+				slot.prev = slot.next = &slot;
+			}
+		}
+	}
+
+	timer_wheel(const timer_wheel&) = delete;
+	timer_wheel& operator=(const timer_wheel&) = delete;
+
+	~timer_wheel()
+	{
+		for (auto& level : wheel_)
+		{
+			for (link& slot : level)
+			{
+				while (slot.next != &slot)
+				{
+					release(unlink(static_cast<node*>(slot.next)));
+				}
+			}
+		}
+	}
+
+	// Schedules f() to run when the wheel reaches the given tick. Ticks in the past run on the
+	// next advance.
+	template <class F>
+	timer_handle schedule_at(uint64_t tick, F&& f)
+	{
+		using func_t = std::decay_t<F>;
+		node* n = acquire();
+		n->callback.template emplace<func_t>(std::forward<F>(f));
+		n->invoke = [](callback_t& callback) { callback.template value<func_t>()(); };
+		n->expiry = tick < now_ ? now_ : tick;
+		insert(n);
+		++size_;
+		return {n, n->generation};
+	}
+
+	template <class F>
+	timer_handle schedule_after(uint64_t delay, F&& f)
+	{
+		return schedule_at(now_ + delay, std::forward<F>(f));
+	}
+
+	// Cancels a pending timer. Returns false if it already ran or was cancelled.
+	bool cancel(timer_handle handle)
+	{
+		if (!pending(handle))
+		{
+			return false;
+		}
+		release(unlink(static_cast<node*>(handle.node)));
+		--size_;
+		return true;
+	}
+
+	bool pending(timer_handle handle) const
+	{
+		auto* n = static_cast<const node*>(handle.node);
+		return n != nullptr && n->generation == handle.generation && n->next != nullptr;
+	}
+
+	// Advances to the given tick, running every timer that expires on the way in expiry
+	// order. Returns the number of timers run.
+	size_t advance_to(uint64_t tick)
+	{
+		size_t fired = 0;
+		while (now_ <= tick && size_ > 0)
+		{
+			// Skip straight to the next tick that has a slot to run or cascade.
+			uint64_t next = next_event();
+			if (next > tick)
+			{
+				break;
+			}
+			now_ = next;
+
+			// Cascade every level whose lower bytes just wrapped, highest first, so timers
+			// land in the levels they now belong to.
+			if ((now_ & slot_mask) == 0 && now_ != 0)
+			{
+				int wrapped = std::countr_zero(now_) / bits_per_level;
+				for (int level = std::min(wrapped, levels - 1); level > 0; --level)
+				{
+					cascade(level);
+				}
+			}
+
+			// The clock moves past this tick before its batch runs, so timers the callbacks
+			// schedule for "now" land in the next tick rather than a slot already taken.
+			link& slot = wheel_[0][now_ & slot_mask];
+			++now_;
+			fired += run_slot(slot);
+		}
+		if (now_ <= tick)
+		{
+			now_ = tick + 1;
+		}
+		return fired;
+	}
+
+	// Processes the next ticks ticks.
+	size_t advance(uint64_t ticks) { return ticks > 0 ? advance_to(now_ + ticks - 1) : 0; }
+
+	// The next tick advance_to has not yet processed.
+	uint64_t now() const { return now_; }
+	size_t size() const { return size_; }
+
+private:
+	static constexpr int bits_per_level = 8;
+	static constexpr int levels = 64 / bits_per_level;
+	static constexpr size_t slots = size_t(1) << bits_per_level;
+	static constexpr uint64_t slot_mask = slots - 1;
+	static constexpr size_t nodes_per_chunk = 256;
+
+	using callback_t = detail::any_base<detail::any_small_buffer_storage<PayloadSize>,
+										any_copy_support::move_only>;
+
+	struct link
+	{
+		link* prev = nullptr;
+		link* next = nullptr;
+	};
+
+	struct node : link
+	{
+		uint64_t expiry = 0;
+		uint32_t generation = 0;
+		void (*invoke)(callback_t&) = nullptr;
+		callback_t callback;
+		// Next node in the pool's free list.
+		node* next_free = nullptr;
+	};
+
+	void insert(node* n)
+	{
+		uint64_t diff = n->expiry ^ now_;
+		int level = diff == 0 ? 0 : (63 - std::countl_zero(diff)) / bits_per_level;
+		size_t index = (n->expiry >> (level * bits_per_level)) & slot_mask;
+		occupied_[level][index / 64] |= uint64_t(1) << (index % 64);
+		link& slot = wheel_[level][index];
+		n->prev = slot.prev;
+		n->next = &slot;
+		slot.prev->next = n;
+		slot.prev = n;
+	}
+
+	static node* unlink(node* n)
+	{
+		n->prev->next = n->next;
+		n->next->prev = n->prev;
+		n->prev = n->next = nullptr;
+		return n;
+	}
+
+	// Detaches a whole slot in O(1) into list, which must be empty.
+	static void splice(link& slot, link& list)
+	{
+		if (slot.next == &slot)
+		{
+			list.prev = list.next = &list;
+			return;
+		}
+		list.next = slot.next;
+		list.prev = slot.prev;
+		list.next->prev = &list;
+		list.prev->next = &list;
+		slot.prev = slot.next = &slot;
+	}
+
+	// Returns the first non-empty slot of a level at or after first, or slots if there is
+	// none. Bits are set on insert and only cleared here and on splice, so a set bit may
+	// belong to a slot whose timers were all cancelled.
+	size_t next_occupied(int level, size_t first)
+	{
+		for (size_t word = first / 64; word < slots / 64; ++word)
+		{
+			uint64_t bits = occupied_[level][word];
+			if (word == first / 64)
+			{
+				bits &= ~uint64_t(0) << (first % 64);
+			}
+			for (; bits != 0; bits &= bits - 1)
+			{
+				size_t index = word * 64 + std::countr_zero(bits);
+				if (wheel_[level][index].next != &wheel_[level][index])
+				{
+					return index;
+				}
+				occupied_[level][word] &= ~(uint64_t(1) << (index % 64));
+			}
+		}
+		return slots;
+	}
+
+	// The earliest tick at or after now_ with a level 0 slot to run or a higher slot to
+	// cascade. A higher level's slot at the current digit is only non-empty while its cascade
+	// at now_ is still due, so every level is searched from its current digit.
+	uint64_t next_event()
+	{
+		size_t current = now_ & slot_mask;
+		if (current != 0 && wheel_[0][current].next != &wheel_[0][current])
+		{
+			return now_;
+		}
+
+		uint64_t next = UINT64_MAX;
+		for (int level = 0; level < levels; ++level)
+		{
+			int shift = level * bits_per_level;
+			size_t index = next_occupied(level, (now_ >> shift) & slot_mask);
+			if (index < slots)
+			{
+				int upper = shift + bits_per_level;
+				uint64_t base = upper < 64 ? now_ >> upper << upper : 0;
+				next = std::min(next, base | uint64_t(index) << shift);
+			}
+		}
+		return next;
+	}
+
+	void cascade(int level)
+	{
+		link pending;
+		size_t index = (now_ >> (level * bits_per_level)) & slot_mask;
+		occupied_[level][index / 64] &= ~(uint64_t(1) << (index % 64));
+		splice(wheel_[level][index], pending);
+		while (pending.next != &pending)
+		{
+			insert(unlink(static_cast<node*>(pending.next)));
+		}
+	}
+
+	size_t run_slot(link& slot)
+	{
+		// Callbacks may schedule or cancel timers, including ones in this batch, so the batch
+		// is detached first and consumed from the front.
+		link batch;
+		splice(slot, batch);
+		size_t fired = 0;
+		while (batch.next != &batch)
+		{
+			node* n = unlink(static_cast<node*>(batch.next));
+			++n->generation;
+			--size_;
+			n->invoke(n->callback);
+			release(n);
+			++fired;
+		}
+		return fired;
+	}
+
+	node* acquire()
+	{
+		if (free_ == nullptr)
+		{
+			chunks_.push_back(std::make_unique<node[]>(nodes_per_chunk));
+			for (size_t i = 0; i < nodes_per_chunk; ++i)
+			{
+				chunks_.back()[i].next_free = free_;
+				free_ = &chunks_.back()[i];
+			}
+		}
+		node* n = free_;
+		free_ = n->next_free;
+		return n;
+	}
+
+	void release(node* n)
+	{
+		++n->generation;
+		n->callback.reset();
+		n->next_free = free_;
+		free_ = n;
+	}
+
+	link wheel_[levels][slots];
+	uint64_t occupied_[levels][slots / 64] = {};
+	uint64_t now_;
+	size_t size_ = 0;
+	node* free_ = nullptr;
+	std::vector<std::unique_ptr<node[]>> chunks_;
+};
+
+} // namespace really
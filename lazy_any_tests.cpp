@@ -0,0 +1,99 @@
+#include "doctest/doctest.h"
+#include "really/lazy_any.hpp"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace really;
+
+TEST_SUITE_BEGIN("lazy_any");
+
+TEST_CASE("lazy-any-runs-factory-on-first-access")
+{
+	int runs = 0;
+	lazy_any lazy([&runs] {
+		++runs;
+		return std::string(40, 'x');
+	});
+
+	CHECK(lazy.has_value());
+	CHECK(lazy.has_type<std::string>());
+	CHECK(lazy.type() == get_type_info<std::string>());
+	// Asking for another type doesn't need the value.
+	CHECK(lazy.try_get_value<int>() == nullptr);
+	CHECK(!lazy.is_materialized());
+	CHECK(runs == 0);
+
+	CHECK(lazy.value<std::string>() == std::string(40, 'x'));
+	CHECK(*lazy.try_get_value<std::string>() == std::string(40, 'x'));
+	CHECK(lazy.is_materialized());
+	CHECK(runs == 1);
+
+	any<> copy = lazy.materialize();
+	CHECK(copy.value<std::string>().size() == 40);
+
+	lazy_any moved = std::move(lazy);
+	CHECK(moved.value<std::string>().size() == 40);
+	CHECK(!lazy.has_value());
+	CHECK(runs == 1);
+
+	lazy_any empty;
+	CHECK(!empty.has_value());
+	CHECK(!empty.materialize().has_value());
+	CHECK(empty.try_get_value<std::string>() == nullptr);
+}
+
+TEST_CASE("lazy-any-move-only-factory-and-retry")
+{
+	auto captured = std::make_unique<int>(7);
+	lazy_any lazy([p = std::move(captured)] { return *p * 6; });
+	CHECK(lazy.value<int>() == 42);
+
+	bool fail = true;
+	lazy_any flaky([&fail] {
+		if (fail)
+		{
+			throw 1;
+		}
+		return 3.5;
+	});
+	bool threw = false;
+	try
+	{
+		flaky.materialize();
+	}
+	catch (int)
+	{
+		threw = true;
+	}
+	CHECK(threw);
+	CHECK(!flaky.is_materialized());
+	fail = false;
+	CHECK(flaky.value<double>() == 3.5);
+}
+
+TEST_CASE("lazy-any-runs-factory-once-across-threads")
+{
+	std::atomic<int> runs{0};
+	lazy_any lazy([&runs] {
+		runs.fetch_add(1);
+		std::this_thread::yield();
+		return std::vector<int>(100, 5);
+	});
+
+	std::atomic<int> total{0};
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 8; ++t)
+	{
+		threads.emplace_back([&] { total.fetch_add(lazy.value<std::vector<int>>()[99]); });
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	CHECK(runs.load() == 1);
+	CHECK(total.load() == 40);
+}
@@ -0,0 +1,113 @@
+#include "doctest/doctest.h"
+#include "really/memory_budget.hpp"
+
+#include <array>
+#include <new>
+#include <thread>
+#include <vector>
+
+using namespace really;
+
+namespace
+{
+using payload = std::array<char, 40>;
+
+memory_budget exact_budget("exact", memory_budget::unlimited, 0);
+memory_budget limited_budget("limited", 64, 0);
+memory_budget batched_budget("batched", memory_budget::unlimited, 1024);
+} // namespace
+
+TEST_SUITE_BEGIN("memory_budget");
+
+TEST_CASE("memory-budget-accounting")
+{
+	using exact_any = budgeted_any<exact_budget>;
+	{
+		// Inline values are free; heap values are charged their size.
+		exact_any small = 1;
+		CHECK(exact_budget.snapshot().used == 0);
+
+		exact_any a = payload{};
+		CHECK(exact_budget.snapshot().used == sizeof(payload));
+		exact_any b = a;
+		CHECK(exact_budget.snapshot().used == 2 * sizeof(payload));
+
+		// Swapping heap values moves their charges with them.
+		a.swap(small);
+		a.reset();
+		CHECK(exact_budget.snapshot().used == 2 * sizeof(payload));
+		small.reset();
+		CHECK(exact_budget.snapshot().used == sizeof(payload));
+	}
+	memory_budget_snapshot s = exact_budget.snapshot();
+	CHECK(s.name == "exact");
+	CHECK(s.used == 0);
+	// The swap went through a temporary, briefly holding a third payload.
+	CHECK(s.peak == 3 * sizeof(payload));
+}
+
+TEST_CASE("memory-budget-hard-limit")
+{
+	using limited_any = budgeted_any<limited_budget>;
+	limited_any a;
+	REQUIRE(a.try_emplace<payload>() != nullptr);
+
+	// A second payload would take the budget over its 64 bytes.
+	limited_any b;
+	CHECK(b.try_emplace<payload>() == nullptr);
+	CHECK(!b.has_value());
+	CHECK(!b.try_assign(a));
+	CHECK(!b.has_value());
+	CHECK(limited_budget.snapshot().failures == 2);
+
+	// Inline values don't count, and freeing makes room again.
+	CHECK(b.try_emplace<int>() != nullptr);
+	a.reset();
+	CHECK(b.try_emplace<payload>() != nullptr);
+	CHECK(limited_budget.snapshot().used == sizeof(payload));
+
+	// Plain emplace and copies throw instead, leaving the destination empty.
+	auto refused = [](auto&& f) {
+		try
+		{
+			f();
+		}
+		catch (const std::bad_alloc&)
+		{
+			return true;
+		}
+		return false;
+	};
+	CHECK(refused([&] { a = b; }));
+	CHECK(!a.has_value());
+	CHECK(refused([&] { a.emplace<payload>(); }));
+	CHECK(!a.has_value());
+	CHECK(refused([&] { limited_any c = b; }));
+	CHECK(limited_budget.snapshot().used == sizeof(payload));
+	CHECK(limited_budget.snapshot().failures == 5);
+}
+
+TEST_CASE("memory-budget-batched-threads")
+{
+	using batched_any = budgeted_any<batched_budget>;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t)
+	{
+		threads.emplace_back([] {
+			std::vector<batched_any> values(1000);
+			for (batched_any& value : values)
+			{
+				value.emplace<payload>();
+			}
+			// Each thread's charge is at most a batch ahead of what it really holds.
+			CHECK(batched_budget.snapshot().used >= values.size() * sizeof(payload));
+		});
+	}
+	for (std::thread& t : threads)
+	{
+		t.join();
+	}
+	// Exiting threads hand back their remaining reserves.
+	CHECK(batched_budget.snapshot().used == 0);
+	CHECK(batched_budget.snapshot().peak >= 1000 * sizeof(payload));
+}
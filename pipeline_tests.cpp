@@ -0,0 +1,131 @@
+#include "doctest/doctest.h"
+#include "really/pipeline.hpp"
+
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace really;
+
+TEST_SUITE_BEGIN("pipeline");
+
+TEST_CASE("pipeline-ordered-stages")
+{
+	auto p = make_pipeline<int>({.buffer_capacity = 8, .batch_size = 4})
+				 .then([](int x) { return x * 2; }, {.name = "double", .parallelism = 4})
+				 .then([](int x) { return std::to_string(x); }, {.name = "format"})
+				 .build();
+	REQUIRE(p.valid());
+
+	std::thread producer([&] {
+		for (int i = 0; i < 1000; ++i)
+		{
+			p.push(i);
+		}
+		p.close();
+	});
+
+	int expected = 0;
+	while (auto value = p.pop())
+	{
+		CHECK(*value == std::to_string(expected * 2));
+		++expected;
+	}
+	producer.join();
+	p.wait();
+	CHECK(expected == 1000);
+
+	auto stats = p.stats();
+	REQUIRE(stats.size() == 2);
+	CHECK(stats[0].name == "double");
+	CHECK(stats[0].items_in == 1000);
+	CHECK(stats[1].items_out == 1000);
+	CHECK(stats[1].input_type == get_type_info<int>());
+	CHECK(stats[1].output_type == get_type_info<std::string>());
+	CHECK(stats[0].max_queue_depth <= 8);
+}
+
+TEST_CASE("pipeline-unordered-filter-and-sink")
+{
+	std::atomic<int> sum = 0;
+	auto p = make_pipeline<int>()
+				 .then([](int x) { return x % 2 == 0 ? std::optional<int>(x) : std::nullopt; },
+					   {.name = "evens", .parallelism = 3, .ordered = false})
+				 .then([&](int x) { sum += x; })
+				 .build();
+
+	for (int i = 0; i < 100; ++i)
+	{
+		p.push(i);
+	}
+	p.wait();
+
+	CHECK(sum == 2450);
+	CHECK(p.stats()[0].items_out == 50);
+}
+
+TEST_CASE("pipeline-runtime-type-checks")
+{
+	// A stage whose output is only known at runtime feeds a typed stage: items are checked
+	// as they arrive.
+	auto p = make_pipeline<movable_any>()
+				 .then<int>([](int x) { return x + 1; })
+				 .build();
+	REQUIRE(p.valid());
+
+	movable_any items[3];
+	items[0].emplace<int>(1);
+	items[1].emplace<std::string>("not an int");
+	items[2].emplace<int>(2);
+	p.push(items, 3);
+	p.close();
+
+	std::vector<int> results;
+	while (auto value = p.pop())
+	{
+		results.push_back(*value);
+	}
+	CHECK(results == std::vector<int>{2, 3});
+	CHECK(p.stats()[0].type_mismatches == 1);
+
+	// Erased stages check their declared input type per item too.
+	auto erased = make_pipeline<movable_any>()
+					  .then_erased(get_type_info<int>(), get_type_info<int>(),
+								   [](movable_any&& value) { return std::move(value); })
+					  .build();
+	REQUIRE(erased.valid());
+	items[0].emplace<int>(1);
+	items[1].emplace<double>(1.5);
+	erased.push(items, 2);
+	erased.close();
+	size_t passed = 0;
+	while (erased.pop())
+	{
+		++passed;
+	}
+	CHECK(passed == 1);
+	CHECK(erased.stats()[0].type_mismatches == 1);
+	CHECK(erased.stats()[0].items_out == 1);
+
+	// Declared runtime types are checked when the pipeline is built.
+	auto bad = make_pipeline<int>()
+				   .then_erased(get_type_info<double>(), get_type_info<movable_any>(),
+								[](movable_any&& value) { return std::move(value); })
+				   .build();
+	CHECK(!bad.valid());
+}
+
+TEST_CASE("pipeline-destroyed-undrained")
+{
+	// The stage blocks on its full output buffer; destruction must still finish.
+	auto p = make_pipeline<int>({.buffer_capacity = 4, .batch_size = 1})
+				 .then([](int x) { return x + 1; })
+				 .build();
+	for (int i = 0; i < 8; ++i)
+	{
+		p.push(i);
+	}
+}
+
+TEST_SUITE_END();
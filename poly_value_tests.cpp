@@ -0,0 +1,145 @@
+#include "doctest/doctest.h"
+#include "really/poly_value.hpp"
+
+#include <stdexcept>
+#include <string>
+
+using namespace really;
+
+namespace
+{
+struct shape
+{
+	virtual ~shape() = default;
+	virtual double area() const = 0;
+};
+
+struct square : shape
+{
+	double side = 0;
+
+	square(double s) : side(s) {}
+	double area() const override { return side * side; }
+};
+
+struct named
+{
+	std::string name = "a name long enough to live outside the small string buffer";
+};
+
+// Large enough to be stored on the heap, with a base that is not at offset zero.
+struct labelled_circle : named, shape
+{
+	double radius = 0;
+
+	labelled_circle(double r) : radius(r) {}
+	double area() const override { return 3.0 * radius * radius; }
+};
+
+// Stored on the heap; its constructor and copy throw while fail is set.
+struct failing_shape : named, shape
+{
+	static inline bool fail = false;
+
+	failing_shape() { check(); }
+	failing_shape(const failing_shape& other) : named(other) { check(); }
+	failing_shape& operator=(const failing_shape&) = default;
+	double area() const override { return 0.0; }
+
+	static void check()
+	{
+		if (fail)
+		{
+			throw std::runtime_error("failing_shape");
+		}
+	}
+};
+} // namespace
+
+TEST_SUITE_BEGIN("poly_value");
+
+TEST_CASE_TEMPLATE("poly-value-copy-and-move", derived_t, square, labelled_circle)
+{
+	poly_value<shape> a = derived_t(2.0);
+	CHECK(a.has_value());
+	CHECK(a->area() == derived_t(2.0).area());
+	CHECK(a.type() == get_type_info<derived_t>());
+	CHECK(a.template try_get<derived_t>() != nullptr);
+
+	// Copies are deep and rebase the cached pointer onto the new object.
+	poly_value<shape> b = a;
+	CHECK(b.get() != a.get());
+	CHECK(b->area() == a->area());
+	b.template try_get<derived_t>()->~derived_t();
+	::new (b.template try_get<derived_t>()) derived_t(3.0);
+	CHECK(b->area() == derived_t(3.0).area());
+	CHECK(a->area() == derived_t(2.0).area());
+
+	poly_value<shape> c = std::move(b);
+	CHECK(!b.has_value());
+	CHECK(c->area() == derived_t(3.0).area());
+	CHECK(static_cast<const void*>(c.get()) ==
+		  static_cast<shape*>(c.template try_get<derived_t>()));
+
+	c = a;
+	CHECK(c->area() == a->area());
+	c.reset();
+	CHECK(!c);
+}
+
+TEST_CASE("poly-value-storage")
+{
+	poly_value<shape> inline_value = square(1.0);
+	poly_value<shape> heap_value = labelled_circle(1.0);
+
+	// Small derived objects live inside the poly_value itself.
+	auto inside = [](const poly_value<shape>& p) {
+		auto* begin = reinterpret_cast<const char*>(&p);
+		auto* ptr = reinterpret_cast<const char*>(p.get());
+		return ptr >= begin && ptr < begin + sizeof(p);
+	};
+	CHECK(inside(inline_value));
+	CHECK(!inside(heap_value));
+
+	// Moving a heap object hands over the pointer.
+	const shape* original = heap_value.get();
+	poly_value<shape> moved = std::move(heap_value);
+	CHECK(moved.get() == original);
+}
+
+TEST_CASE("poly-value-throwing-construction")
+{
+	poly_value<shape> value = square(2.0);
+	failing_shape::fail = true;
+	bool thrown = false;
+	try
+	{
+		value.emplace<failing_shape>();
+	}
+	catch (const std::runtime_error&)
+	{
+		thrown = true;
+	}
+	CHECK(thrown);
+	CHECK(!value.has_value());
+
+	// The storage was given back, so the value can be used again.
+	failing_shape::fail = false;
+	value.emplace<failing_shape>();
+	CHECK(value.type() == get_type_info<failing_shape>());
+
+	failing_shape::fail = true;
+	thrown = false;
+	try
+	{
+		poly_value<shape> copy = value;
+	}
+	catch (const std::runtime_error&)
+	{
+		thrown = true;
+	}
+	CHECK(thrown);
+	failing_shape::fail = false;
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,89 @@
+#include "doctest/doctest.h"
+#include "really/recycling_pool.hpp"
+
+#include <thread>
+#include <vector>
+
+using namespace really;
+
+namespace
+{
+struct buffer
+{
+	std::vector<char> bytes;
+
+	buffer() { bytes.reserve(4096); }
+};
+
+void recycle(buffer& b)
+{
+	b.bytes.clear();
+}
+} // namespace
+
+TEST_SUITE_BEGIN("recycling_pool");
+
+TEST_CASE("recycling-pool-reuses-objects")
+{
+	recycling_pool<> pool(4, 0);
+
+	any<> a = pool.acquire<buffer>();
+	buffer* original = a.try_get_value<buffer>();
+	REQUIRE(original != nullptr);
+	original->bytes.assign(100, 'x');
+	const char* storage = original->bytes.data();
+
+	CHECK(pool.release(std::move(a)));
+	CHECK(pool.available<buffer>() == 1);
+
+	// The same object comes back, cleared by its recycle hook but with its capacity intact.
+	any<> b = pool.acquire<buffer>();
+	CHECK(b.try_get_value<buffer>() == original);
+	CHECK(b.value<buffer>().bytes.empty());
+	CHECK(b.value<buffer>().bytes.data() == storage);
+	CHECK(pool.available<buffer>() == 0);
+
+	// Empty anys are not pooled.
+	CHECK(!pool.release(any<>()));
+}
+
+TEST_CASE("recycling-pool-caps")
+{
+	recycling_pool<> pool(4, 0);
+	pool.set_capacity<buffer>(2);
+	for (int i = 0; i < 3; ++i)
+	{
+		CHECK(pool.release(any<>(buffer())) == (i < 2));
+	}
+	CHECK(pool.available<buffer>() == 2);
+
+	pool.set_capacity<buffer>(1);
+	CHECK(pool.available<buffer>() == 1);
+
+	pool.clear();
+	CHECK(pool.available<buffer>() == 0);
+}
+
+TEST_CASE("recycling-pool-thread-cache")
+{
+	recycling_pool<> pool(16, 2);
+	std::thread worker([&] {
+		std::vector<any<>> held;
+		for (int i = 0; i < 3; ++i)
+		{
+			held.push_back(pool.acquire<buffer>());
+		}
+		for (any<>& value : held)
+		{
+			pool.release(std::move(value));
+		}
+
+		// Two objects stay in this thread's front cache, the third spills to the pool.
+		CHECK(pool.available<buffer>() == 1);
+		pool.flush_thread_cache();
+		CHECK(pool.available<buffer>() == 3);
+	});
+	worker.join();
+}
+
+TEST_SUITE_END();
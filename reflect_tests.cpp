@@ -0,0 +1,131 @@
+#include "doctest/doctest.h"
+#include "really/reflect.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace really;
+
+namespace
+{
+struct point
+{
+	int x;
+	int y;
+};
+
+struct padded
+{
+	char tag;
+	double value;
+};
+
+// No padding at the top level, but the nested field has three bytes of it.
+struct nested_padded
+{
+	int id;
+	struct
+	{
+		char c;
+		int i;
+	} inner;
+};
+
+struct segment
+{
+	point from;
+	point to;
+	float weight;
+};
+
+struct record
+{
+	std::string name;
+	point position;
+	std::vector<int> values;
+	float weight;
+};
+} // namespace
+
+template <>
+inline constexpr bool really::enable_aggregate_ops<record> = true;
+
+static_assert(field_count<point> == 2);
+static_assert(field_count<padded> == 2);
+static_assert(field_count<record> == 4);
+static_assert(reflect_impl::bytewise_serializable<point>);
+static_assert(!reflect_impl::bytewise_serializable<padded>);
+static_assert(!reflect_impl::bytewise_serializable<record>);
+static_assert(!reflect_impl::bytewise_serializable<nested_padded>);
+static_assert(reflect_impl::bytewise_serializable<segment>);
+
+TEST_SUITE_BEGIN("reflect");
+
+TEST_CASE("aggregate-operations")
+{
+	CHECK(aggregate_equal(point{1, 2}, point{1, 2}));
+	CHECK(!aggregate_equal(point{1, 2}, point{1, 3}));
+	CHECK(aggregate_hash(point{1, 2}) == aggregate_hash(point{1, 2}));
+	CHECK(aggregate_compare(point{1, 2}, point{1, 3}) < 0);
+	CHECK(aggregate_compare(point{2, 0}, point{1, 3}) > 0);
+
+	// Padding bytes don't take part in field-wise equality and hashing.
+	padded a{}, b{};
+	std::memset(static_cast<void*>(&a), 0x11, sizeof(a));
+	std::memset(static_cast<void*>(&b), 0x22, sizeof(b));
+	a.tag = b.tag = 'x';
+	a.value = b.value = 1.5;
+	CHECK(aggregate_equal(a, b));
+	CHECK(aggregate_hash(a) == aggregate_hash(b));
+
+	record r{"name", {3, 4}, {1, 2, 3}, 0.5f};
+	std::vector<std::byte> bytes;
+	aggregate_serialize(r, bytes);
+
+	record copy{};
+	std::span<const std::byte> in = bytes;
+	CHECK(aggregate_deserialize(copy, in));
+	CHECK(in.empty());
+	CHECK(aggregate_equal(r, copy));
+
+	// Truncated input fails.
+	record partial{};
+	std::span<const std::byte> truncated(bytes.data(), bytes.size() - 1);
+	CHECK(!aggregate_deserialize(partial, truncated));
+
+	// A nested padded field is written field by field, so its padding never reaches the bytes.
+	nested_padded n{7, {'c', 9}};
+	bytes.clear();
+	aggregate_serialize(n, bytes);
+	CHECK(bytes.size() == sizeof(int) + sizeof(char) + sizeof(int));
+	nested_padded n_copy{};
+	in = bytes;
+	CHECK(aggregate_deserialize(n_copy, in));
+	CHECK(n_copy.inner.c == 'c');
+	CHECK(n_copy.inner.i == 9);
+}
+
+TEST_CASE("aggregate-operations-through-any")
+{
+	any<> a = record{"a", {1, 2}, {}, 1.0f};
+	any<> b = a;
+	any<> c = record{"c", {1, 2}, {}, 1.0f};
+	CHECK(a.operations()->value_ops() != nullptr);
+	CHECK(any_equal(a, b));
+	CHECK(!any_equal(a, c));
+	CHECK(any_hash(a) == any_hash(b));
+	CHECK(any_compare(a, c) < 0);
+
+	std::vector<std::byte> bytes;
+	CHECK(any_serialize(c, bytes));
+	std::span<const std::byte> in = bytes;
+	CHECK(any_deserialize(b, in));
+	CHECK(any_equal(b, c));
+
+	// Types that did not opt in have no value operations.
+	any<> p = point{1, 2};
+	CHECK(p.operations()->value_ops() == nullptr);
+	CHECK(!any_serialize(p, bytes));
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,106 @@
+#include "doctest/doctest.h"
+#include "really/slot_map.hpp"
+
+#include <stdexcept>
+#include <string>
+
+using namespace really;
+
+TEST_SUITE_BEGIN("slot_map");
+
+TEST_CASE_TEMPLATE("slot-map-basic-usage", any_t, copyable_any, movable_any)
+{
+	slot_map<any_t> map;
+	slot_handle a = map.template emplace<int>(1);
+	slot_handle b = map.template emplace<std::string>("two");
+	slot_handle c = map.template emplace<int>(3);
+	CHECK(map.size() == 3);
+
+	CHECK(map.contains(b));
+	CHECK(*map.template get<std::string>(b) == "two");
+	CHECK(map.template get<int>(b) == nullptr);
+
+	// Erasing moves the last value into the hole but leaves other handles valid.
+	CHECK(map.erase(a));
+	CHECK(!map.erase(a));
+	CHECK(!map.contains(a));
+	CHECK(map.get(a) == nullptr);
+	CHECK(map.size() == 2);
+	CHECK(*map.template get<int>(c) == 3);
+
+	// Reusing a slot bumps its generation, so the stale handle stays dead.
+	slot_handle d = map.template emplace<int>(4);
+	CHECK(d.index == a.index);
+	CHECK(d.generation != a.generation);
+	CHECK(map.get(a) == nullptr);
+	CHECK(*map.template get<int>(d) == 4);
+
+	map.clear();
+	CHECK(map.empty());
+	CHECK(!map.contains(b));
+}
+
+TEST_CASE("slot-map-dense-iteration")
+{
+	slot_map<> map;
+	for (int i = 0; i < 10; ++i)
+	{
+		map.emplace<int>(i);
+		map.emplace<double>(i * 0.5);
+	}
+
+	int sum = 0;
+	map.for_each<int>([&](slot_handle handle, int& value) {
+		CHECK(map.get<int>(handle) == &value);
+		sum += value;
+	});
+	CHECK(sum == 45);
+
+	size_t count = 0;
+	for (const any<>& value : map)
+	{
+		count += value.has_value();
+	}
+	CHECK(count == 20);
+
+	for (size_t i = 0; i < map.size(); ++i)
+	{
+		CHECK(map.get(map.handle_at(i)) == &map.values()[i]);
+	}
+}
+
+TEST_CASE("slot-map-throwing-emplace")
+{
+	struct throws_on_construction
+	{
+		throws_on_construction() { throw std::runtime_error("construction"); }
+	};
+
+	slot_map<> map;
+	slot_handle a = map.emplace<int>(1);
+	slot_handle b = map.emplace<int>(2);
+	map.erase(a);
+
+	bool thrown = false;
+	try
+	{
+		map.emplace<throws_on_construction>();
+	}
+	catch (const std::runtime_error&)
+	{
+		thrown = true;
+	}
+	CHECK(thrown);
+	CHECK(map.size() == 1);
+	CHECK(*map.get<int>(b) == 2);
+
+	// The freed slot was not consumed, so the next value reuses it with a new generation.
+	slot_handle c = map.emplace<int>(3);
+	CHECK(c.index == a.index);
+	CHECK(c.generation != a.generation);
+	CHECK(!map.contains(a));
+	CHECK(map.size() == 2);
+	CHECK(map.handle_at(1) == c);
+}
+
+TEST_SUITE_END();
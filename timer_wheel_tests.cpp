@@ -0,0 +1,94 @@
+#include "doctest/doctest.h"
+#include "really/timer_wheel.hpp"
+
+#include <memory>
+#include <vector>
+
+using namespace really;
+
+TEST_SUITE_BEGIN("timer_wheel");
+
+TEST_CASE("timer-wheel-schedule-and-cancel")
+{
+	timer_wheel<> wheel;
+	std::vector<int> fired;
+	wheel.schedule_after(5, [&] { fired.push_back(5); });
+	wheel.schedule_after(1, [&] { fired.push_back(1); });
+	timer_handle cancelled = wheel.schedule_after(3, [&] { fired.push_back(3); });
+	CHECK(wheel.size() == 3);
+
+	CHECK(wheel.pending(cancelled));
+	CHECK(wheel.cancel(cancelled));
+	CHECK(!wheel.cancel(cancelled));
+	CHECK(wheel.size() == 2);
+
+	CHECK(wheel.advance_to(4) == 1);
+	CHECK(fired == std::vector<int>{1});
+	CHECK(wheel.advance(1) == 1);
+	CHECK(fired == std::vector<int>{1, 5});
+	CHECK(wheel.size() == 0);
+
+	// A node reused for a new timer does not revive the old handle.
+	timer_handle reused = wheel.schedule_after(2, [&] { fired.push_back(7); });
+	CHECK(!wheel.pending(cancelled));
+	CHECK(wheel.pending(reused));
+
+	// Payloads that do not fit inline still work, and unrun ones are destroyed with the wheel.
+	auto big = std::make_shared<std::vector<int>>(100, 1);
+	wheel.schedule_after(10, [big, pad = std::vector<int>(8)] { (void)pad; });
+	CHECK(big.use_count() == 2);
+	wheel.cancel(reused);
+	wheel.advance(11);
+	CHECK(big.use_count() == 1);
+}
+
+TEST_CASE("timer-wheel-cascades-across-levels")
+{
+	timer_wheel<> wheel(250);
+	std::vector<uint64_t> fired;
+	std::vector<uint64_t> deadlines = {255, 256, 300, 65535, 65536, 70000, 1ull << 24, 1ull << 33};
+	for (uint64_t deadline : deadlines)
+	{
+		wheel.schedule_at(deadline, [&, deadline] {
+			// Every timer runs exactly on its tick.
+			CHECK(wheel.now() == deadline + 1);
+			fired.push_back(deadline);
+		});
+	}
+
+	wheel.advance_to(1ull << 34);
+	CHECK(fired == deadlines);
+}
+
+TEST_CASE("timer-wheel-callbacks-reschedule")
+{
+	timer_wheel<> wheel;
+	int runs = 0;
+	bool victim_ran = false;
+	timer_handle victim;
+
+	// A callback can reschedule itself for "now", which runs on the next tick, and can cancel
+	// another timer from the same batch.
+	struct repeat
+	{
+		timer_wheel<>* wheel;
+		int* runs;
+		void operator()() const
+		{
+			if (++*runs < 3)
+			{
+				wheel->schedule_at(wheel->now(), *this);
+			}
+		}
+	};
+	wheel.schedule_at(10, [&] { CHECK(wheel.cancel(victim)); });
+	victim = wheel.schedule_at(10, [&] { victim_ran = true; });
+	wheel.schedule_at(10, repeat{&wheel, &runs});
+
+	CHECK(wheel.advance_to(10) == 2);
+	CHECK(runs == 1);
+	CHECK(!victim_ran);
+	CHECK(wheel.advance_to(12) == 2);
+	CHECK(runs == 3);
+	CHECK(wheel.size() == 0);
+}